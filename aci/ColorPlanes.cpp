@@ -0,0 +1,57 @@
+#include "ColorPlanes.h"
+
+ColorPlanes::ColorPlanes(const Mat_<Vec3f> &labImage)
+	: lab(labImage)
+{
+
+}
+
+const Mat_<Vec3f> &ColorPlanes::getLab() const {
+	return this->lab;
+}
+
+const Mat_<Vec3f> &ColorPlanes::getRGB() {
+	if (this->rgb.empty()) {
+		cvtColor(this->lab, this->rgb, CV_Lab2RGB);
+	}
+
+	return this->rgb;
+}
+
+const Mat_<Vec3f> &ColorPlanes::getHSV() {
+	if (this->hsv.empty()) {
+		cvtColor(this->getRGB(), this->hsv, CV_RGB2HSV);
+	}
+
+	return this->hsv;
+}
+
+const Mat_<float> &ColorPlanes::getLabPlane(int channel) {
+	assert(channel >= 0 && channel < 3);
+
+	if (this->labPlanes.empty()) {
+		split(this->lab, this->labPlanes);
+	}
+
+	return this->labPlanes[channel];
+}
+
+const Mat_<float> &ColorPlanes::getRGBPlane(int channel) {
+	assert(channel >= 0 && channel < 3);
+
+	if (this->rgbPlanes.empty()) {
+		split(this->getRGB(), this->rgbPlanes);
+	}
+
+	return this->rgbPlanes[channel];
+}
+
+const Mat_<float> &ColorPlanes::getHSVPlane(int channel) {
+	assert(channel >= 0 && channel < 3);
+
+	if (this->hsvPlanes.empty()) {
+		split(this->getHSV(), this->hsvPlanes);
+	}
+
+	return this->hsvPlanes[channel];
+}
@@ -0,0 +1,69 @@
+/** @file */
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+using namespace cv;
+
+/**
+ * Per image cache of color planes. Holds an image in the L*a*b* color space,
+ * and computes its RGB and HSV conversions as well as the separate channels
+ * of each color space lazily, at most once each. Channels are contiguous
+ * single channel matrices. Create one per image and pass it to all functions
+ * needing colors of the image, rather than converting it in each of them.
+ */
+class ColorPlanes {
+private:
+	Mat_<Vec3f> lab;
+	Mat_<Vec3f> rgb;
+	Mat_<Vec3f> hsv;
+	vector<Mat_<float> > labPlanes;
+	vector<Mat_<float> > rgbPlanes;
+	vector<Mat_<float> > hsvPlanes;
+
+public:
+	/**
+	 * Initializes the cache for an image.
+	 *
+	 * @param labImage image in the L*a*b* color space, as returned by preProcessing.
+	 * It is shared, not copied, so it should not be modified afterwards.
+	 */
+	ColorPlanes(const Mat_<Vec3f> &labImage);
+
+	/**
+	 * Returns the image in the L*a*b* color space.
+	 */
+	const Mat_<Vec3f> &getLab() const;
+
+	/**
+	 * Returns the image in the RGB color space, with channels in [0;1].
+	 */
+	const Mat_<Vec3f> &getRGB();
+
+	/**
+	 * Returns the image in the HSV color space, with hue in [0;360].
+	 */
+	const Mat_<Vec3f> &getHSV();
+
+	/**
+	 * Returns a channel of the image in the L*a*b* color space.
+	 *
+	 * @param channel 0 for L*, 1 for a* and 2 for b*.
+	 */
+	const Mat_<float> &getLabPlane(int channel);
+
+	/**
+	 * Returns a channel of the image in the RGB color space.
+	 *
+	 * @param channel 0 for red, 1 for green and 2 for blue.
+	 */
+	const Mat_<float> &getRGBPlane(int channel);
+
+	/**
+	 * Returns a channel of the image in the HSV color space.
+	 *
+	 * @param channel 0 for hue, 1 for saturation and 2 for value.
+	 */
+	const Mat_<float> &getHSVPlane(int channel);
+};
@@ -0,0 +1,88 @@
+#include "ConcurrentDisjointSet.hpp"
+
+#define PARALLEL_FOREST_THRESHOLD 10000
+
+ConcurrentDisjointSetForest::ConcurrentDisjointSetForest(int numberOfElements)
+	: numberOfElements(numberOfElements),
+	parents(new boost::atomic<int>[numberOfElements]),
+	componentSizes(new boost::atomic<int>[numberOfElements]),
+	numberOfComponents(numberOfElements)
+{
+	#pragma omp parallel for if(numberOfElements > PARALLEL_FOREST_THRESHOLD)
+	for (int i = 0; i < numberOfElements; i++) {
+		this->parents[i].store(i, boost::memory_order_relaxed);
+		this->componentSizes[i].store(1, boost::memory_order_relaxed);
+	}
+}
+
+int ConcurrentDisjointSetForest::find(int element) {
+	int parent = this->parents[element].load(boost::memory_order_relaxed);
+
+	while (parent != element) {
+		int grandParent = this->parents[parent].load(boost::memory_order_relaxed);
+
+		// if another thread modified the parent in the meantime, it did
+		// so to point it closer to the root so we can ignore failure.
+		if (parent != grandParent) {
+			this->parents[element].compare_exchange_weak(parent, grandParent, boost::memory_order_relaxed);
+		}
+		element = grandParent;
+		parent = this->parents[element].load(boost::memory_order_relaxed);
+	}
+
+	return element;
+}
+
+void ConcurrentDisjointSetForest::addComponentSize(int root, int amount) {
+	// a size added to a root which has been linked in the meantime may
+	// have been missed by the thread which linked it, so it is taken back
+	// and moved to the new root. Exchanges make sure each part of the size
+	// is moved by exactly one thread.
+	while (amount != 0) {
+		this->componentSizes[root].fetch_add(amount);
+
+		if (this->parents[root].load() == root) {
+			return;
+		}
+
+		amount = this->componentSizes[root].exchange(0);
+		root = this->find(root);
+	}
+}
+
+bool ConcurrentDisjointSetForest::setUnion(int element1, int element2) {
+	while (true) {
+		int root1 = this->find(element1);
+		int root2 = this->find(element2);
+
+		if (root1 == root2) {
+			return false;
+		}
+		if (root1 < root2) {
+			swap(root1, root2);
+		}
+
+		// only succeeds if root1 is still a root, otherwise another thread
+		// linked it first and we retry from the new roots.
+		int expected = root1;
+
+		if (this->parents[root1].compare_exchange_strong(expected, root2)) {
+			this->numberOfComponents--;
+			this->addComponentSize(root2, this->componentSizes[root1].exchange(0));
+
+			return true;
+		}
+	}
+}
+
+int ConcurrentDisjointSetForest::getComponentSize(int element) {
+	return this->componentSizes[this->find(element)].load();
+}
+
+int ConcurrentDisjointSetForest::getNumberOfComponents() const {
+	return this->numberOfComponents.load();
+}
+
+int ConcurrentDisjointSetForest::getNumberOfElements() const {
+	return this->numberOfElements;
+}
@@ -0,0 +1,83 @@
+/** @file */
+/**
+ * Disjoint set forest which supports concurrent unions and finds from
+ * several threads without locks. Sets are linked by compare and swap on
+ * the parent of a root, always linking the root with the largest index
+ * under the one with the smallest, so the representant of a set is its
+ * smallest element. Finds halve paths with compare and swap too, and
+ * never block. Component sizes are moved to the new root after each
+ * link, so they are exact once all threads are done with unions.
+ *
+ * Use it for the parallel phase of an algorithm, then convert it to a
+ * DisjointSetForest for sequential processing.
+ */
+#pragma once
+
+#include <cstdint>
+#include <boost/atomic.hpp>
+#include <boost/scoped_array.hpp>
+
+using namespace std;
+
+class ConcurrentDisjointSetForest {
+private:
+  int numberOfElements;
+  boost::scoped_array<boost::atomic<int> > parents;
+  boost::scoped_array<boost::atomic<int> > componentSizes;
+  boost::atomic<int> numberOfComponents;
+
+  // atomics cannot be copied.
+  ConcurrentDisjointSetForest(const ConcurrentDisjointSetForest &forest);
+  ConcurrentDisjointSetForest &operator=(const ConcurrentDisjointSetForest &forest);
+
+  /**
+   * Adds an amount to the size of a root. If the root gets linked
+   * concurrently, moves the size of the former root to its new root
+   * until it lands in an actual root.
+   */
+  void addComponentSize(int root, int amount);
+
+public:
+  /**
+   * Initializes a forest where each element is in its own set.
+   *
+   * @param numberOfElements number of elements to partition.
+   */
+  ConcurrentDisjointSetForest(int numberOfElements);
+
+  /**
+   * Returns the representant of the set containing a specific element,
+   * ie. its smallest element. Safe to call concurrently with unions,
+   * in which case the result may be outdated by the time it returns.
+   *
+   * @param element an element from a set.
+   * @return the representant of the set containing the element.
+   */
+  int find(int element);
+
+  /**
+   * Fuses the sets containing 2 elements. Safe to call concurrently with
+   * other unions and finds.
+   *
+   * @param element1 an element from the first set.
+   * @param element2 an element from the second set.
+   * @return true iff the elements were in different sets.
+   */
+  bool setUnion(int element1, int element2);
+
+  /**
+   * Returns the size of the component containing a specific element.
+   * Exact only when no union is running concurrently.
+   */
+  int getComponentSize(int element);
+
+  /**
+   * Returns the number of components of the partition.
+   */
+  int getNumberOfComponents() const;
+
+  /**
+   * Returns the number of elements of the partition.
+   */
+  int getNumberOfElements() const;
+};
@@ -16,22 +16,66 @@ DisjointSetForest::DisjointSetForest(int numberOfElements)
 	}
 }
 
+DisjointSetForest::DisjointSetForest(int numberOfElements, const int *roots, const int *componentSizes, const int *ranks)
+	: forest(numberOfElements),
+	numberOfComponents(0),
+	componentSizes(componentSizes, componentSizes + numberOfElements),
+	isModified(true)
+{
+	for (int i = 0; i < numberOfElements; i++) {
+		this->forest[i].parent = roots[i];
+
+		if (roots[i] == i) {
+			this->forest[i].rank = ranks == NULL ? 1 : ranks[i];
+			this->numberOfComponents++;
+		} else {
+			this->forest[i].rank = 0;
+		}
+	}
+}
+
+DisjointSetForest::DisjointSetForest(ConcurrentDisjointSetForest &concurrentForest)
+	: forest(concurrentForest.getNumberOfElements()),
+	numberOfComponents(concurrentForest.getNumberOfComponents()),
+	componentSizes(concurrentForest.getNumberOfElements(), 0),
+	isModified(true)
+{
+	// the concurrent forest may have long paths, so elements are linked
+	// directly to their root.
+	for (int i = 0; i < (int)this->forest.size(); i++) {
+		int root = concurrentForest.find(i);
+
+		this->forest[i].parent = root;
+
+		if (root == i) {
+			this->forest[i].rank = 1;
+			this->componentSizes[i] = concurrentForest.getComponentSize(i);
+		} else {
+			this->forest[i].rank = 0;
+		}
+	}
+}
+
 int DisjointSetForest::constFind(int element) const {
-	if (this->forest[element].parent == element) {
-		return element;
-	} else {
-		return this->constFind(this->forest[element].parent);
+	while (this->forest[element].parent != element) {
+		element = this->forest[element].parent;
 	}
+
+	return element;
 }
 
 int DisjointSetForest::find(int element) {
-	int currentParent = this->forest[element].parent;
-
-	if (currentParent != element) {
-		this->forest[element].parent = this->find(currentParent);
+	// path halving: makes every other node on the path point to its
+	// grandparent, which has the same amortized complexity as full path
+	// compression in a single pass without recursion.
+	while (this->forest[element].parent != element) {
+		int grandParent = this->forest[this->forest[element].parent].parent;
+
+		this->forest[element].parent = grandParent;
+		element = grandParent;
 	}
 
-	return this->forest[element].parent;
+	return element;
 }
 
 int DisjointSetForest::setUnion(int element1, int element2) {
@@ -79,13 +123,11 @@ Mat_<Vec<uchar, 3> > DisjointSetForest::toRegionImage(Mat_<Vec<uchar,3> > source
 		colors = colors_;
 	}
 
-	map<int,int> rootIdx = this->getRootIndexes();
+	const vector<int> &segmentIndexes = this->getSegmentIndexes();
 
 	for (int i = 0; i < sourceImage.rows; i++) {
 		for (int j = 0; j < sourceImage.cols; j++) {
-			int root = rootIdx[this->find(toRowMajor(sourceImage.cols, j, i))];
-
-			regions(i, j) = colors[root];
+			regions(i, j) = colors[segmentIndexes[toRowMajor(sourceImage.cols, j, i)]];
 		}
 	}
 
@@ -96,27 +138,93 @@ int DisjointSetForest::getNumberOfComponents() const {
 	return this->numberOfComponents;
 }
 
-map<int,int> DisjointSetForest::getRootIndexes() {
+void DisjointSetForest::updateSegmentIndexes() {
 	if (!this->isModified) {
-		return this->rootIndexes;
+		return;
 	}
-	// if the forest has been modified, recompute the indexes.
-	this->rootIndexes.clear();
-	int currentIndex = 0;
+	// if the forest has been modified, recompute the indexes. Roots get
+	// their index when first encountered, other elements then look up the
+	// index of their root.
+	this->segmentIndexes.assign(this->forest.size(), -1);
+	this->segmentRoots.clear();
+	this->segmentOffsets.clear();
+	this->segmentElements.clear();
+	this->segmentRoots.reserve(this->numberOfComponents);
 
 	for (int i = 0; i < (int)this->forest.size(); i++) {
 		int root = this->find(i);
-		map<int,int>::iterator it = this->rootIndexes.find(root);
 
-		if (it == this->rootIndexes.end()) {
-			this->rootIndexes[root] = currentIndex;
-			currentIndex++;
+		if (this->segmentIndexes[root] < 0) {
+			this->segmentIndexes[root] = this->segmentRoots.size();
+			this->segmentRoots.push_back(root);
 		}
+		this->segmentIndexes[i] = this->segmentIndexes[root];
 	}
 
 	this->isModified = false;
+}
+
+void DisjointSetForest::updateSegmentElements() {
+	this->updateSegmentIndexes();
+
+	if (!this->segmentOffsets.empty()) {
+		return;
+	}
+	// counting sort of elements by segment index: counts the size of each
+	// segment, turns counts into offsets then places elements in order.
+	int numberOfSegments = (int)this->segmentRoots.size();
+
+	this->segmentOffsets.assign(numberOfSegments + 1, 0);
+	this->segmentElements.resize(this->forest.size());
+
+	for (int i = 0; i < (int)this->forest.size(); i++) {
+		this->segmentOffsets[this->segmentIndexes[i] + 1]++;
+	}
+
+	for (int i = 0; i < numberOfSegments; i++) {
+		this->segmentOffsets[i + 1] += this->segmentOffsets[i];
+	}
+
+	vector<int> positions(this->segmentOffsets.begin(), this->segmentOffsets.end() - 1);
+
+	for (int i = 0; i < (int)this->forest.size(); i++) {
+		this->segmentElements[positions[this->segmentIndexes[i]]++] = i;
+	}
+}
+
+map<int,int> DisjointSetForest::getRootIndexes() {
+	const vector<int> &segmentRoots = this->getSegmentRoots();
+	map<int,int> rootIndexes;
+
+	for (int i = 0; i < (int)segmentRoots.size(); i++) {
+		rootIndexes[segmentRoots[i]] = i;
+	}
+
+	return rootIndexes;
+}
+
+const vector<int> &DisjointSetForest::getSegmentIndexes() {
+	this->updateSegmentIndexes();
+
+	return this->segmentIndexes;
+}
+
+const vector<int> &DisjointSetForest::getSegmentRoots() {
+	this->updateSegmentIndexes();
+
+	return this->segmentRoots;
+}
+
+const vector<int> &DisjointSetForest::getSegmentOffsets() {
+	this->updateSegmentElements();
 
-	return this->rootIndexes;
+	return this->segmentOffsets;
+}
+
+const vector<int> &DisjointSetForest::getSegmentElements() {
+	this->updateSegmentElements();
+
+	return this->segmentElements;
 }
 
 int DisjointSetForest::getComponentSize(int element) {
@@ -125,17 +233,20 @@ int DisjointSetForest::getComponentSize(int element) {
 	return this->componentSizes[root];
 }
 
+int DisjointSetForest::getRank(int element) {
+	return this->forest[this->find(element)].rank;
+}
+
 int DisjointSetForest::getNumberOfElements() const {
 	return this->forest.size();
 }
 
 ostream &operator<<(ostream &os, DisjointSetForest &forest) {
 	vector<vector<int>> comps(forest.getNumberOfComponents());
+	const vector<int> &segmentIndexes = forest.getSegmentIndexes();
 
 	for (int i = 0; i < forest.getNumberOfElements(); i++) {
-		int root = forest.find(i);
-
-		comps[forest.getRootIndexes()[root]].push_back(i);
+		comps[segmentIndexes[i]].push_back(i);
 	}
 
 	os<<"(";
@@ -175,6 +286,122 @@ void DisjointSetForest::fuseSmallComponents(WeightedGraph &segmentedGraph, int m
 	}
 }
 
+void DisjointSetForest::fuseSmallComponents(const Mat_<float> &mask, int minSize) {
+	assert(this->getNumberOfElements() >= mask.rows * mask.cols);
+
+	if (minSize <= 1) {
+		return;
+	}
+
+	// initial segment indexes are kept to identify segments, the current
+	// segment of an initial one being the one of the root of its root.
+	vector<int> segmentIndexes = this->getSegmentIndexes();
+	vector<int> segmentRoots = this->getSegmentRoots();
+	int numberOfSegments = (int)segmentRoots.size();
+	vector<char> foreground(numberOfSegments);
+
+	for (int s = 0; s < numberOfSegments; s++) {
+		foreground[s] = segmentRoots[s] < mask.rows * mask.cols 
+			&& mask(segmentRoots[s] / mask.cols, segmentRoots[s] % mask.cols) != 0;
+	}
+
+	// lists for each segment the segment on the other side of each pair of
+	// neighboring pixels on its border, so the number of occurrences of a
+	// segment is the length of their common border.
+	vector<vector<int> > borders(numberOfSegments);
+
+	for (int i = 0; i < mask.rows; i++) {
+		for (int j = 0; j < mask.cols; j++) {
+			if (mask(i,j) == 0) {
+				continue;
+			}
+			int pixel = toRowMajor(mask.cols, j, i);
+			int segment = segmentIndexes[pixel];
+
+			if (j + 1 < mask.cols && mask(i,j + 1) != 0 && segmentIndexes[pixel + 1] != segment) {
+				borders[segment].push_back(segmentIndexes[pixel + 1]);
+				borders[segmentIndexes[pixel + 1]].push_back(segment);
+			}
+			if (i + 1 < mask.rows && mask(i + 1,j) != 0 && segmentIndexes[pixel + mask.cols] != segment) {
+				borders[segment].push_back(segmentIndexes[pixel + mask.cols]);
+				borders[segmentIndexes[pixel + mask.cols]].push_back(segment);
+			}
+		}
+	}
+
+	// bucket queue of small segments indexed by size. Fusing a segment only
+	// queues segments in larger buckets, so buckets are processed in order.
+	vector<vector<int> > buckets(minSize);
+
+	for (int s = 0; s < numberOfSegments; s++) {
+		int size = this->getComponentSize(segmentRoots[s]);
+
+		if (foreground[s] && size < minSize) {
+			buckets[size].push_back(s);
+		}
+	}
+
+	vector<int> borderLengths(numberOfSegments, 0);
+	vector<int> neighbors;
+
+	for (int size = 1; size < minSize; size++) {
+		for (int b = 0; b < (int)buckets[size].size(); b++) {
+			int segment = buckets[size][b];
+			int root = segmentRoots[segment];
+
+			// the segment has been fused or has grown since it was queued.
+			if (this->find(root) != root || this->getComponentSize(root) != size) {
+				continue;
+			}
+
+			int best = -1;
+
+			for (int k = 0; k < (int)borders[segment].size(); k++) {
+				int neighbor = segmentIndexes[this->find(segmentRoots[borders[segment][k]])];
+
+				if (neighbor == segment || !foreground[neighbor]) {
+					continue;
+				}
+				if (borderLengths[neighbor] == 0) {
+					neighbors.push_back(neighbor);
+				}
+				borderLengths[neighbor]++;
+
+				if (best < 0 || borderLengths[neighbor] > borderLengths[best]) {
+					best = neighbor;
+				}
+			}
+
+			for (int k = 0; k < (int)neighbors.size(); k++) {
+				borderLengths[neighbors[k]] = 0;
+			}
+			neighbors.clear();
+
+			if (best < 0) {
+				continue;
+			}
+
+			int newRoot = this->setUnion(root, segmentRoots[best]);
+			int fused = segmentIndexes[newRoot];
+			int absorbed = fused == segment ? best : segment;
+
+			// the fused segment gets the borders of both, appending the
+			// shortest list to the longest.
+			if (borders[fused].size() < borders[absorbed].size()) {
+				borders[fused].swap(borders[absorbed]);
+			}
+			borders[fused].insert(borders[fused].end(), borders[absorbed].begin(), borders[absorbed].end());
+			vector<int>().swap(borders[absorbed]);
+
+			int newSize = this->getComponentSize(newRoot);
+
+			if (newSize < minSize) {
+				buckets[newSize].push_back(fused);
+			}
+		}
+	}
+}
+
 /*
 void DisjointSetForest::fuseCloseComponents(const LabeledGraph<Mat> &segmentationGraph, double (*distFunc)(const Mat&, const Mat&), double threshold) {
 	map<int,int> rootIndexes_ = this->getRootIndexes();
@@ -203,16 +430,21 @@ void gravityCenters(const Mat_<Vec3f> &image, const Mat_<float> &mask, DisjointS
 	for (int i = 0; i < segmentation.getNumberOfComponents(); i++) {
 		centers.push_back(Vec2f(0,0));
 	}
-	map<int,int> rootIndexes = segmentation.getRootIndexes();
+	const vector<int> &segmentOffsets = segmentation.getSegmentOffsets();
+	const vector<int> &segmentElements = segmentation.getSegmentElements();
+
+	#pragma omp parallel for if(segmentation.getNumberOfElements() > PARALLEL_SEGMENTS_THRESHOLD)
+	for (int s = 0; s < segmentation.getNumberOfComponents(); s++) {
+		float segmentSize = (float)(segmentOffsets[s + 1] - segmentOffsets[s]);
+
+		for (int k = segmentOffsets[s]; k < segmentOffsets[s + 1]; k++) {
+			int i = segmentElements[k] / image.cols;
+			int j = segmentElements[k] % image.cols;
 
-	for (int i = 0; i < image.rows; i++) {
-		for (int j = 0; j < image.cols; j++) {
 			if (mask(i,j) > 0) {
-				int root = segmentation.find(toRowMajor(image.cols, j, i));
-				int segmentIndex = rootIndexes[root];
 				Vec2f position = Vec2f((float)i,(float)j);
 
-				centers[segmentIndex] += position / (float)segmentation.getComponentSize(root);
+				centers[s] += position / segmentSize;
 			}
 		}
 	}
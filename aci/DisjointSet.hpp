@@ -11,11 +11,16 @@
 #include <opencv2/opencv.hpp>
 
 #include "WeightedGraph.hpp"
+#include "ConcurrentDisjointSet.hpp"
 #include "Utils.hpp"
 
 using namespace std;
 using namespace cv;
 
+// below this number of elements, computations over the elements of each
+// segment run sequentially.
+#define PARALLEL_SEGMENTS_THRESHOLD 10000
+
 struct DisjointSet {
   int parent;
   int rank;
@@ -27,7 +32,21 @@ private:
   int numberOfComponents;
   vector<int> componentSizes;
   bool isModified;
-  map<int,int> rootIndexes;
+  vector<int> segmentIndexes;
+  vector<int> segmentRoots;
+  vector<int> segmentOffsets;
+  vector<int> segmentElements;
+
+  /**
+   * Recomputes the segment index of each element if the forest has been
+   * modified since the last call.
+   */
+  void updateSegmentIndexes();
+  /**
+   * Recomputes the elements of each segment if the forest has been
+   * modified since they were last computed.
+   */
+  void updateSegmentElements();
 
 public:
   DisjointSetForest(); // should not be called
@@ -39,10 +58,40 @@ public:
    * corresponding to the number of singletons at initialization.
    */
   DisjointSetForest(int numberOfElements);
+  /**
+   * Initializes the forest from a flat partition, where each element points
+   * directly to the root of its set. Runs in O(n) time.
+   *
+   * @param numberOfElements the number of elements in the partition.
+   * @param roots numberOfElements sized array containing the root of the set
+   * of each element, roots being their own root.
+   * @param componentSizes numberOfElements sized array containing the size
+   * of the set of each root. Entries for non-root elements are ignored.
+   * @param ranks optional numberOfElements sized array containing the rank
+   * of each root, so further unions pick the same roots as in the forest the
+   * partition comes from. Entries for non-root elements are ignored.
+   */
+  DisjointSetForest(int numberOfElements, const int *roots, const int *componentSizes, const int *ranks = NULL);
+  /**
+   * Initializes a forest with the same partition as a concurrent forest,
+   * typically once a parallel phase of unions is over. Runs in O(n) time.
+   *
+   * @param concurrentForest forest to copy, on which no union should run
+   * concurrently.
+   */
+  DisjointSetForest(ConcurrentDisjointSetForest &concurrentForest);
 
+  /**
+   * Returns the representant of the set containing a specific element,
+   * without modifying the forest.
+   *
+   * @param element an element from a set.
+   * @return the representant of the set containing the element.
+   */
   int constFind(int element) const;
   /**
    * Returns the representant of the set containing a specific element.
+   * Iterative, halving the path from the element to the root.
    *
    * @param element an element from a set.
    * @return the representant of the set containing the element.
@@ -71,13 +120,48 @@ public:
   /**
    * Map associating a linear index in [0..getNumberOfComponents]
    * to each component root. Runs in O(n) time where n is the number
-   * of leaves in the forest (ie. elements to partition).
+   * of leaves in the forest (ie. elements to partition). Prefer
+   * getSegmentIndexes or getSegmentRoots which avoid the map.
    */
   map<int,int> getRootIndexes();
+  /**
+   * Vector associating to each element the linear index in
+   * [0..getNumberOfComponents] of its component, ie. a label image
+   * in row major order when elements are pixels. Segments are indexed
+   * in order of their first element, consistently with getRootIndexes.
+   * Cached, so it only costs O(n) after the forest has been modified.
+   * The reference is invalidated by the next union.
+   */
+  const vector<int> &getSegmentIndexes();
+  /**
+   * Vector associating to each segment index the root of the
+   * corresponding component, inverse of getRootIndexes. Cached as
+   * getSegmentIndexes.
+   */
+  const vector<int> &getSegmentRoots();
+  /**
+   * Offsets of the elements of each segment in getSegmentElements, in
+   * compressed sparse row format: elements of the segment with index i
+   * are in [offsets[i]..offsets[i+1]), so the vector has
+   * getNumberOfComponents() + 1 entries. Cached as getSegmentIndexes.
+   */
+  const vector<int> &getSegmentOffsets();
+  /**
+   * Elements of the partition grouped by segment, in increasing order
+   * within each segment, see getSegmentOffsets. Computed with a single
+   * counting sort pass, so features can iterate over the pixels of each
+   * segment contiguously, and over segments in parallel.
+   */
+  const vector<int> &getSegmentElements();
   /**
    * Returns the size of the component containing a specific element.
    */
   int getComponentSize(int element);
+  /**
+   * Returns the rank of the root of the component containing a specific
+   * element.
+   */
+  int getRank(int element);
   /**
    * Returns the total number of elements this forest partitions.
    */
@@ -93,6 +177,24 @@ public:
    * @param minSize size below which components will get fused out.
    */
   void fuseSmallComponents(WeightedGraph &segmentedGraph, int minSize, const Mat_<float> &mask);
+
+  /**
+   * Fuses components below a minimum size with their neighbors in an image,
+   * until no component is below the minimum size. Small components are
+   * processed from the smallest using a bucket queue, each one being fused
+   * with the neighbor it shares the longest border with. Neighborhoods are
+   * computed from the 4-connectivity of pixels, without building a grid
+   * graph. Runs in O(n + m log m) time where m is the number of pixels on
+   * segment borders, usually much smaller than n.
+   *
+   * Components whose root is a background pixel are neither fused nor
+   * grown, so small components without a foreground neighbor are left as is.
+   *
+   * @param mask mask of the image, whose pixels are the first elements
+   * of the forest in row major order.
+   * @param minSize size below which components will get fused out.
+   */
+  void fuseSmallComponents(const Mat_<float> &mask, int minSize);
 };
 
 /**
@@ -1,31 +1,17 @@
 #include "Felzenszwalb.hpp"
 
-static bool compareWeights(Edge edge1, Edge edge2) {
-  return edge1.weight < edge2.weight;
-}
+// below this number of edges, segmentations are combined sequentially.
+#define PARALLEL_SEGMENTATION_THRESHOLD 10000
 
 static double constOne(const Mat& m1, const Mat& m2) {
 	return 1;
 }
 
-DisjointSetForest felzenszwalbSegment(int k, WeightedGraph graph, int minCompSize, Mat_<float> mask, ScaleType scaleType) {
-	// sorts edge in increasing weight order
-	vector<Edge> edges = graph.getEdges();
-	sort(edges.begin(), edges.end(), compareWeights);
-
-	// initializes the disjoint set forest to keep track of components, as
-	// well as structures to keep track of component size, degree and internal
-	// differences.
-	DisjointSetForest segmentation(graph.numberOfVertices());
-	vector<float> internalDifferences(graph.numberOfVertices(), 0);
-	vector<float> volumes(graph.numberOfVertices());
-
-	for (int i = 0; i < graph.numberOfVertices(); i++) {
-		volumes[i] = graph.degree(i);
-	}
-
-	// Goes through the edges, and fuses vertices if they pass a check,
-	// updating internal differences.
+/**
+ * Goes through edges in increasing weight order, and fuses vertices if they
+ * pass Felzenszwalb's check, updating internal differences and volumes.
+ */
+static void felzenszwalbMerge(int k, const vector<Edge> &edges, DisjointSetForest &segmentation, vector<float> &internalDifferences, vector<float> &volumes, ScaleType scaleType) {
 	for (int i = 0; i < (int)edges.size(); i++) {
 		Edge currentEdge = edges[i];
 		int root1 = segmentation.find(currentEdge.source);
@@ -49,11 +35,16 @@ DisjointSetForest felzenszwalbSegment(int k, WeightedGraph graph, int minCompSiz
 			internalDifferences[newRoot] = currentEdge.weight;
 		}
 	}
+}
 
+/**
+ * Fuses background into a single, unconnected component, then fuses
+ * components smaller than minCompSize.
+ */
+static void felzenszwalbPostProcessing(DisjointSetForest &segmentation, int minCompSize, const Mat_<float> &mask) {
 	bool firstBgPixelFound = false;
 	int bgSegment = -1;
 
-	// Fuses background into a single, unconnected component
 	for (int i = 0; i < mask.rows; i++) {
 		for (int j = 0; j < mask.cols; j++) {
 			if (mask(i,j) <= 0) {
@@ -67,97 +58,398 @@ DisjointSetForest felzenszwalbSegment(int k, WeightedGraph graph, int minCompSiz
 		}
 	}
 
-	segmentation.fuseSmallComponents(graph, minCompSize, mask);
+	segmentation.fuseSmallComponents(mask, minCompSize);
+}
+
+DisjointSetForest felzenszwalbSegment(int k, WeightedGraph graph, int minCompSize, Mat_<float> mask, ScaleType scaleType) {
+	// sorts edge in increasing weight order
+	vector<Edge> edges = graph.getEdges();
+	sortEdgesByWeight(edges);
+
+	// initializes the disjoint set forest to keep track of components, as
+	// well as structures to keep track of component size, degree and internal
+	// differences.
+	DisjointSetForest segmentation(graph.numberOfVertices());
+	vector<float> internalDifferences(graph.numberOfVertices(), 0);
+	vector<float> volumes(graph.numberOfVertices());
+
+	for (int i = 0; i < graph.numberOfVertices(); i++) {
+		volumes[i] = graph.degree(i);
+	}
+
+	felzenszwalbMerge(k, edges, segmentation, internalDifferences, volumes, scaleType);
+	felzenszwalbPostProcessing(segmentation, minCompSize, mask);
 
 	return segmentation;
 }
 
-DisjointSetForest combineSegmentations(const WeightedGraph &graph, vector<DisjointSetForest> &segmentations) {
-  DisjointSetForest combination(graph.numberOfVertices());
-  vector<Edge> edges = graph.getEdges();
+DisjointSetForest tiledFelzenszwalbSegment(int k, const WeightedGraph &graph, int minCompSize, const Mat_<float> &mask, int tileSize, ScaleType scaleType) {
+	assert(graph.numberOfVertices() == mask.rows * mask.cols && tileSize > 0);
+	int n = graph.numberOfVertices();
+	int tilesPerRow = (mask.cols + tileSize - 1) / tileSize;
+	int tilesPerColumn = (mask.rows + tileSize - 1) / tileSize;
+	int nbTiles = tilesPerRow * tilesPerColumn;
+
+	// sorts edges once, then splits them between tiles and the boundary
+	// keeping their order. Edges within a tile use indexes local to the tile.
+	vector<Edge> edges = graph.getEdges();
+	sortEdgesByWeight(edges);
+	vector<vector<Edge> > tileEdges(nbTiles);
+	vector<Edge> boundaryEdges;
+
+	for (int i = 0; i < (int)edges.size(); i++) {
+		// (row, column) coordinates of the endpoints.
+		pair<int,int> src = fromRowMajor(mask.cols, edges[i].source);
+		pair<int,int> dst = fromRowMajor(mask.cols, edges[i].destination);
+		int srcTile = toRowMajor(tilesPerRow, src.second / tileSize, src.first / tileSize);
+		int dstTile = toRowMajor(tilesPerRow, dst.second / tileSize, dst.first / tileSize);
+
+		if (srcTile == dstTile) {
+			int tileWidth = min(tileSize, mask.cols - (src.second / tileSize) * tileSize);
+			Edge local = edges[i];
+
+			local.source = toRowMajor(tileWidth, src.second % tileSize, src.first % tileSize);
+			local.destination = toRowMajor(tileWidth, dst.second % tileSize, dst.first % tileSize);
+			tileEdges[srcTile].push_back(local);
+		} else {
+			boundaryEdges.push_back(edges[i]);
+		}
+	}
+
+	// segments tiles independently, each with its own forest. Tiles only
+	// write to the entries of their own pixels in the global structures.
+	vector<int> roots(n);
+	vector<int> componentSizes(n, 0);
+	vector<int> ranks(n, 0);
+	vector<float> internalDifferences(n, 0);
+	vector<float> volumes(n);
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int t = 0; t < nbTiles; t++) {
+		int tileX = (t % tilesPerRow) * tileSize;
+		int tileY = (t / tilesPerRow) * tileSize;
+		int tileWidth = min(tileSize, mask.cols - tileX);
+		int tileHeight = min(tileSize, mask.rows - tileY);
+		int tileN = tileWidth * tileHeight;
+		DisjointSetForest tileSegmentation(tileN);
+		vector<float> tileInternalDifferences(tileN, 0);
+		vector<float> tileVolumes(tileN);
+		vector<int> toGlobal(tileN);
+
+		for (int i = 0; i < tileN; i++) {
+			pair<int,int> local = fromRowMajor(tileWidth, i);
+
+			toGlobal[i] = toRowMajor(mask.cols, tileX + local.second, tileY + local.first);
+			tileVolumes[i] = graph.degree(toGlobal[i]);
+		}
+
+		felzenszwalbMerge(k, tileEdges[t], tileSegmentation, tileInternalDifferences, tileVolumes, scaleType);
+
+		for (int i = 0; i < tileN; i++) {
+			int root = tileSegmentation.find(i);
+
+			roots[toGlobal[i]] = toGlobal[root];
+
+			if (root == i) {
+				componentSizes[toGlobal[i]] = tileSegmentation.getComponentSize(i);
+				ranks[toGlobal[i]] = tileSegmentation.getRank(i);
+				internalDifferences[toGlobal[i]] = tileInternalDifferences[i];
+				volumes[toGlobal[i]] = tileVolumes[i];
+			}
+		}
+	}
+
+	// merges tile segments across tile boundaries, in weight order and with
+	// the same criterion, starting from the internal differences and volumes
+	// computed in the tiles. Ranks are kept so unions, and therefore the
+	// roots post processing tells background from foreground by, are the
+	// ones of the sequential segmentation within tiles.
+	DisjointSetForest segmentation(n, &roots[0], &componentSizes[0], &ranks[0]);
+
+	felzenszwalbMerge(k, boundaryEdges, segmentation, internalDifferences, volumes, scaleType);
+	felzenszwalbPostProcessing(segmentation, minCompSize, mask);
+
+	return segmentation;
+}
+
+FelzenszwalbHierarchy::FelzenszwalbHierarchy(const WeightedGraph &graph, const Mat_<float> &mask, ScaleType scaleType)
+	: mask(mask), scaleType(scaleType), sortedEdges(graph.getEdges()), degrees(graph.numberOfVertices())
+{
+	sortEdgesByWeight(this->sortedEdges);
+
+	for (int i = 0; i < graph.numberOfVertices(); i++) {
+		this->degrees[i] = graph.degree(i);
+	}
+
+	// Kruskal's algorithm, keeping track of the largest internal edge and
+	// size of each component. Since edges come in increasing weight order,
+	// the criterion w <= Int(C) + k/|C| holds for both components as soon
+	// as k >= (w - Int(C))|C| for both.
+	DisjointSetForest forest(graph.numberOfVertices());
+	vector<float> internalDifferences(graph.numberOfVertices(), 0);
+	vector<float> volumes(this->degrees);
+
+	for (int i = 0; i < (int)this->sortedEdges.size(); i++) {
+		Edge edge = this->sortedEdges[i];
+		int root1 = forest.find(edge.source);
+		int root2 = forest.find(edge.destination);
+
+		if (root1 == root2) {
+			continue;
+		}
+
+		float size1 = scaleType == CARDINALITY ? (float)forest.getComponentSize(root1) : volumes[root1];
+		float size2 = scaleType == CARDINALITY ? (float)forest.getComponentSize(root2) : volumes[root2];
+		float scale = max((edge.weight - internalDifferences[root1]) * size1, (edge.weight - internalDifferences[root2]) * size2);
+		int newRoot = forest.setUnion(root1, root2);
+
+		volumes[newRoot] = volumes[root1] + volumes[root2];
+		internalDifferences[newRoot] = edge.weight;
+		this->mergeEdges.push_back(edge);
+		this->mergeScales.push_back(scale);
+	}
+}
+
+DisjointSetForest FelzenszwalbHierarchy::segment(int k, int minCompSize) {
+	DisjointSetForest segmentation(this->degrees.size());
+	vector<float> internalDifferences(this->degrees.size(), 0);
+	vector<float> volumes(this->degrees);
+
+	felzenszwalbMerge(k, this->sortedEdges, segmentation, internalDifferences, volumes, this->scaleType);
+	felzenszwalbPostProcessing(segmentation, minCompSize, this->mask);
+
+	return segmentation;
+}
+
+DisjointSetForest FelzenszwalbHierarchy::segmentFromMergeTree(float k, int minCompSize) {
+	DisjointSetForest segmentation(this->degrees.size());
+
+	for (int i = 0; i < (int)this->mergeEdges.size(); i++) {
+		if (this->mergeScales[i] <= k) {
+			segmentation.setUnion(this->mergeEdges[i].source, this->mergeEdges[i].destination);
+		}
+	}
+
+	felzenszwalbPostProcessing(segmentation, minCompSize, this->mask);
+
+	return segmentation;
+}
+
+const vector<Edge> &FelzenszwalbHierarchy::getMergeEdges() const {
+	return this->mergeEdges;
+}
+
+const vector<float> &FelzenszwalbHierarchy::getMergeScales() const {
+	return this->mergeScales;
+}
+
+double segmentationAgreement(DisjointSetForest &segmentation1, DisjointSetForest &segmentation2) {
+	assert(segmentation1.getNumberOfElements() == segmentation2.getNumberOfElements());
+	int n = segmentation1.getNumberOfElements();
+
+	if (n < 2) {
+		return 1;
+	}
+
+	const vector<int> &indexes1 = segmentation1.getSegmentIndexes();
+	const vector<int> &indexes2 = segmentation2.getSegmentIndexes();
+	long long nbSegments2 = segmentation2.getNumberOfComponents();
+	vector<long long> contingency(n);
+
+	// counts elements in each pair of segments by sorting the pairs.
+	for (int i = 0; i < n; i++) {
+		contingency[i] = indexes1[i] * nbSegments2 + indexes2[i];
+	}
+	sort(contingency.begin(), contingency.end());
+
+	double bothSame = 0;
+	int runStart = 0;
+
+	for (int i = 1; i <= n; i++) {
+		if (i == n || contingency[i] != contingency[runStart]) {
+			double count = i - runStart;
+
+			bothSame += count * (count - 1) / 2;
+			runStart = i;
+		}
+	}
+
+	// pairs in the same segment in one segmentation but not the other are
+	// disagreements.
+	double same1 = 0;
+	double same2 = 0;
+	const vector<int> &offsets1 = segmentation1.getSegmentOffsets();
+	const vector<int> &offsets2 = segmentation2.getSegmentOffsets();
+
+	for (int i = 0; i < segmentation1.getNumberOfComponents(); i++) {
+		double size = offsets1[i + 1] - offsets1[i];
+
+		same1 += size * (size - 1) / 2;
+	}
+	for (int i = 0; i < segmentation2.getNumberOfComponents(); i++) {
+		double size = offsets2[i + 1] - offsets2[i];
+
+		same2 += size * (size - 1) / 2;
+	}
+
+	double nbPairs = (double)n * (n - 1) / 2;
 
+	return 1 - (same1 + same2 - 2 * bothSame) / nbPairs;
+}
+
+/**
+ * Intersection of several partitions of the same elements, given as a label
+ * image where the labels of each element in every partition are contiguous:
+ * two neighboring elements are in the same component iff they have the same
+ * labels in all partitions.
+ */
+static DisjointSetForest intersectLabels(const vector<Edge> &edges, int numberOfElements, const vector<int> &labels, int numberOfPartitions) {
+  ConcurrentDisjointSetForest intersection(numberOfElements);
+
+  #pragma omp parallel for if(edges.size() > PARALLEL_SEGMENTATION_THRESHOLD)
   for (int i = 0; i < (int)edges.size(); i++) {
-    Edge edge = edges[i];
+    const int *sourceLabels = &labels[edges[i].source * numberOfPartitions];
+    const int *destinationLabels = &labels[edges[i].destination * numberOfPartitions];
     bool areInSameComponents = true;
 
-    for (int j = 0; j < (int)segmentations.size(); j++) {
-      int sourceRoot = segmentations[j].find(edge.source);
-      int destinationRoot = segmentations[j].find(edge.destination);
-      
-      areInSameComponents = 
-	areInSameComponents && (sourceRoot == destinationRoot);
+    for (int j = 0; j < numberOfPartitions && areInSameComponents; j++) {
+      areInSameComponents = sourceLabels[j] == destinationLabels[j];
     }
 
     if (areInSameComponents) {
-      combination.setUnion(edge.source, edge.destination);
+      intersection.setUnion(edges[i].source, edges[i].destination);
     }
   }
 
-  return combination;
+  return DisjointSetForest(intersection);
 }
 
-class EdgeCompare {
-public:
-	EdgeCompare();
+DisjointSetForest combineSegmentations(const WeightedGraph &graph, vector<DisjointSetForest> &segmentations) {
+  int n = graph.numberOfVertices();
+  int nbSegmentations = (int)segmentations.size();
+  vector<int> labels(n * nbSegmentations);
 
-	bool operator()(const Edge &e1, const Edge &e2) {
-		return e1.weight > e2.weight;
-	}
-};
-/*
-typedef fibonacci_heap<Edge, boost::heap::compare<EdgeCompare> > PriorityQueue;
-typedef typename PriorityQueue::handle_type handle_t;
+  // find modifies the segmentations, so segment indexes are gathered
+  // beforehand into a label image shared between threads.
+  for (int j = 0; j < nbSegmentations; j++) {
+    const vector<int> &segmentIndexes = segmentations[j].getSegmentIndexes();
+
+    for (int i = 0; i < n; i++) {
+      labels[i * nbSegmentations + j] = segmentIndexes[i];
+    }
+  }
 
-static void updateWeights(PriorityQueue &queue, vector<list<pair<handle_t, int> > > &bidirAdjList, DisjointSetForest &segmentation, int vertex) {
-	for (int i = 0; i < (int)bidirAdjList[vertex].size(); i++) {
-		pair<handle_t, int> dst = bidirAdjList[vertex][i];
-		int srcSize = segmentation.getComponentSize(vertex);
-		int dstSize = segmentation.getComponentSize(dst.second);
+  return intersectLabels(graph.getEdges(), n, labels, nbSegmentations);
+}
 
-		queue.increase(dst.first, srcSize + dstSize);
-	}
+DisjointSetForest multiChannelFelzenszwalbSegment(int k, const WeightedGraph &graph, const Mat_<Vec3f> &image, int minCompSize, const Mat_<float> &mask, ScaleType scaleType) {
+  assert(graph.numberOfVertices() == image.rows * image.cols);
+  const int nbChannels = 3;
+  int n = graph.numberOfVertices();
+  const vector<Edge> &edges = graph.getEdges();
+  vector<int> labels(n * nbChannels);
+
+  // channels only differ by edge weights, so each one copies the shared edge
+  // list with its own weights and the resulting vertex degrees, sorts it and
+  // segments it on its own thread.
+  #pragma omp parallel for
+  for (int c = 0; c < nbChannels; c++) {
+    vector<Edge> channelEdges(edges);
+    vector<double> degrees(n, 0);
+
+    for (int i = 0; i < (int)channelEdges.size(); i++) {
+      pair<int,int> src = fromRowMajor(image.cols, channelEdges[i].source);
+      pair<int,int> dst = fromRowMajor(image.cols, channelEdges[i].destination);
+
+      channelEdges[i].weight = (float)fabs(image(src.first, src.second)[c] - image(dst.first, dst.second)[c]);
+      degrees[channelEdges[i].source] += channelEdges[i].weight;
+      degrees[channelEdges[i].destination] += channelEdges[i].weight;
+    }
+    sortEdgesByWeight(channelEdges);
+
+    DisjointSetForest channelSegmentation(n);
+    vector<float> internalDifferences(n, 0);
+    vector<float> volumes(degrees.begin(), degrees.end());
+
+    felzenszwalbMerge(k, channelEdges, channelSegmentation, internalDifferences, volumes, scaleType);
+    felzenszwalbPostProcessing(channelSegmentation, minCompSize, mask);
+
+    const vector<int> &segmentIndexes = channelSegmentation.getSegmentIndexes();
+
+    for (int i = 0; i < n; i++) {
+      labels[i * nbChannels + c] = segmentIndexes[i];
+    }
+  }
+
+  DisjointSetForest segmentation = intersectLabels(edges, n, labels, nbChannels);
+
+  felzenszwalbPostProcessing(segmentation, minCompSize, mask);
+
+  return segmentation;
 }
 
-void fuseComponentsDownTo(int nbComponents, DisjointSetForest &segmentation, const WeightedGraph& gridGraph) {
-	// Compute the region adjacency graph of the segmentation, weighted by
-	// sum of incident segment cardinality.
-	WeightedGraph rag = segmentationGraph(segmentation, gridGraph);
+/**
+ * Candidate merge of 2 adjacent regions, weighted by the sum of their
+ * areas when it was queued.
+ */
+struct SegmentMerge {
+	int region1;
+	int region2;
+	int size;
+};
+
+class SegmentMergeCompare {
+public:
+	bool operator()(const SegmentMerge &merge1, const SegmentMerge &merge2) const {
+		return merge1.size > merge2.size;
+	}
+};
 
-	// store the edges, weighed by sum of incident segment size, into a min-heap
-	// mutable priority queue data structure.
-	
-	// bidirectional adjacency list data structure for storing incident edges
-	// handles
-	vector<list<pair<handle_t, int> > > bidirAdjList(rag.numberOfVertices());
-	EdgeCompare compare;
-	PriorityQueue queue(compare);
+static void queueMerges(const DynamicRegionAdjacencyGraph &rag, int region, priority_queue<SegmentMerge, vector<SegmentMerge>, SegmentMergeCompare> &queue) {
+	const vector<RegionBorder> &borders = rag.getBorders(region);
 
-	for (int i = 0; i < (int)rag.getEdges().size(); i++) {
-		Edge edge = rag.getEdges()[i];
-		Edge weighted;
-		int srcSize = segmentation.getComponentSize(edge.source);
-		int dstSize = segmentation.getComponentSize(edge.destination);
+	for (int i = 0; i < (int)borders.size(); i++) {
+		SegmentMerge merge;
 
-		weighted.source = edge.source;
-		weighted.destination = edge.destination;
-		weighted.weight = srcSize + dstSize;
+		merge.region1 = region;
+		merge.region2 = borders[i].region;
+		merge.size = rag.getArea(region) + rag.getArea(borders[i].region);
+		queue.push(merge);
+	}
+}
 
-		handle_t edgeHandle = queue.push(weighted);
+void fuseComponentsDownTo(int nbComponents, DisjointSetForest &segmentation, const WeightedGraph& gridGraph, vector<pair<int,int> > *merges) {
+	if (segmentation.getNumberOfComponents() <= nbComponents) {
+		return;
+	}
+	// regions are numbered like the initial segments.
+	vector<int> segmentRoots = segmentation.getSegmentRoots();
+
+	// queues every edge of the region adjacency graph, weighted by sum of
+	// incident region areas, into a min-heap.
+	DynamicRegionAdjacencyGraph rag(segmentation, regionAdjacencyGraph(segmentation, gridGraph));
+	priority_queue<SegmentMerge, vector<SegmentMerge>, SegmentMergeCompare> queue;
 
-		bidirAdjList[edge.source].push_back(pair<handle_t, int>(edgeHandle, edge.destination));
-		bidirAdjList[edge.destination].push_back(pair<handle_t, int>(edgeHandle, edge.source));
+	for (int r = 0; r < rag.getRegionCapacity(); r++) {
+		queueMerges(rag, r, queue);
 	}
 
-	// pop edges from the queue, fusing source and destination until the number of
-	// components is small enough. Update weights accordingly.
-	while (segmentation.getNumberOfComponents() > nbComponents) {
-		Edge smallest = queue.top();
+	// pop merges from the queue, fusing regions until the number of
+	// components is small enough. After each merge, the merges of the new
+	// region are queued with their current size, so merges involving a dead
+	// region or with an outdated size have been superseded and are skipped.
+	while (segmentation.getNumberOfComponents() > nbComponents && !queue.empty()) {
+		SegmentMerge smallest = queue.top();
 		queue.pop();
 
-		segmentation.setUnion(smallest.source, smallest.destination);
+		if (!rag.isAlive(smallest.region1) || !rag.isAlive(smallest.region2)
+			|| rag.getArea(smallest.region1) + rag.getArea(smallest.region2) != smallest.size) {
+			continue;
+		}
 
-		updateWeights(queue, bidirAdjList, segmentation, smallest.source);
-		updateWeigths(queue, bidirAdjList, segmentation, smallest.destination);
+		if (merges != NULL) {
+			merges->push_back(pair<int,int>(segmentRoots[smallest.region1], segmentRoots[smallest.region2]));
+		}
+		queueMerges(rag, rag.merge(smallest.region1, smallest.region2), queue);
 	}
 }
-*/
\ No newline at end of file
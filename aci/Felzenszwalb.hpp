@@ -8,7 +8,7 @@
 #include <vector>
 #include <algorithm>
 #include <opencv2/opencv.hpp>
-#include <boost/heap/fibonacci_heap.hpp>
+#include <queue>
 
 #include "WeightedGraph.hpp"
 #include "DisjointSet.hpp"
@@ -18,7 +18,6 @@
 
 using namespace std;
 using namespace cv;
-using namespace boost::heap;
 
 /**
  * Type specifying which type of scale measure to use for segment sizes, either
@@ -43,6 +42,106 @@ enum ScaleType { CARDINALITY, VOLUME };
  */
 DisjointSetForest felzenszwalbSegment(int k, WeightedGraph graph, int minCompSize, Mat_<float> mask, ScaleType scaleType = CARDINALITY);
 
+/**
+ * Parallel variant of felzenszwalbSegment for large images. Splits the image
+ * into square tiles which are segmented independently on separate threads,
+ * then merges segments across tile boundaries by going through the edges
+ * between tiles in weight order, with the same criterion. Post processing is
+ * the same as felzenszwalbSegment's.
+ *
+ * The result differs from the sequential one when a boundary edge would have
+ * been processed before edges within a tile, as the tile segments it sees are
+ * then larger and have larger internal differences. Use segmentationAgreement
+ * against felzenszwalbSegment to choose a tile size: larger tiles agree more
+ * but leave fewer tiles to run in parallel.
+ *
+ * @param k scale parameter.
+ * @param graph the graph to segment, whose vertices are the pixels of the mask
+ * in row major order.
+ * @param minCompSize minimum size of components.
+ * @param mask mask of the image, defining its dimensions.
+ * @param tileSize width and height of tiles in pixels.
+ * @param scaleType type of scale measure to use for segment size.
+ * @return a segmentation of the graph.
+ */
+DisjointSetForest tiledFelzenszwalbSegment(int k, const WeightedGraph &graph, int minCompSize, const Mat_<float> &mask, int tileSize, ScaleType scaleType = CARDINALITY);
+
+/**
+ * Felzenszwalb segmentation of a graph at many scales. Sorts edges and
+ * computes vertex volumes once, so each segmentation for a new value of k
+ * only costs a union find pass over the sorted edges, instead of rebuilding
+ * and sorting the graph.
+ *
+ * Also records a merge tree: the minimum spanning forest edges in the order
+ * Kruskal's algorithm adds them, each with the smallest scale k at which
+ * Felzenszwalb's criterion accepts it given the components it joins in the
+ * forest. Thresholding these scales gives a segmentation for any k in
+ * linear time, and segmentations for increasing k are nested. It
+ * approximates felzenszwalbSegment, whose components at a given k can be
+ * smaller than in the full forest, so use segment for exact results.
+ */
+class FelzenszwalbHierarchy {
+private:
+  Mat_<float> mask;
+  ScaleType scaleType;
+  vector<Edge> sortedEdges;
+  vector<float> degrees;
+  vector<Edge> mergeEdges;
+  vector<float> mergeScales;
+
+public:
+  /**
+   * Sorts the edges of a graph and computes its merge tree.
+   *
+   * @param graph the graph to segment.
+   * @param mask mask of the image the graph was built from.
+   * @param scaleType type of scale measure to use for segment size.
+   */
+  FelzenszwalbHierarchy(const WeightedGraph &graph, const Mat_<float> &mask, ScaleType scaleType = CARDINALITY);
+
+  /**
+   * Segments the graph at a given scale. The result is the same as
+   * felzenszwalbSegment's with the same parameters.
+   *
+   * @param k scale parameter.
+   * @param minCompSize minimum size of components.
+   */
+  DisjointSetForest segment(int k, int minCompSize);
+
+  /**
+   * Segments the graph at a given scale by keeping the merges of the merge
+   * tree whose scale is at most k, then post processes it as segment does.
+   *
+   * @param k scale parameter.
+   * @param minCompSize minimum size of components.
+   */
+  DisjointSetForest segmentFromMergeTree(float k, int minCompSize);
+
+  /**
+   * Edges of the merge tree, in the order they are merged by Kruskal's
+   * algorithm.
+   */
+  const vector<Edge> &getMergeEdges() const;
+
+  /**
+   * Smallest scale at which each edge of the merge tree is merged.
+   */
+  const vector<float> &getMergeScales() const;
+};
+
+/**
+ * Rand index between 2 segmentations of the same elements: the fraction of
+ * pairs of elements on which they agree, ie. which are either in the same
+ * segment in both or in different segments in both. 1 means identical
+ * partitions. With many segments most pairs are in different segments in
+ * both, so meaningful values are very close to 1. Runs in O(n log n) time.
+ *
+ * @param segmentation1 first segmentation.
+ * @param segmentation2 second segmentation, with the same number of elements.
+ * @return the Rand index of the segmentations, in [0;1].
+ */
+double segmentationAgreement(DisjointSetForest &segmentation1, DisjointSetForest &segmentation2);
+
 /**
  * Combines segmentations of the same graph by the following rule:
  * two neighboring vertices in the graph are in the same component iff
@@ -57,16 +156,42 @@ DisjointSetForest felzenszwalbSegment(int k, WeightedGraph graph, int minCompSiz
  */
 DisjointSetForest combineSegmentations(const WeightedGraph &imageGraph, vector<DisjointSetForest> &segmentations);
 
+/**
+ * Segments each channel of an image separately with Felzenszwalb's method,
+ * then combines the channel segmentations as combineSegmentations does. The
+ * channels are segmented concurrently on separate threads, sharing the edges
+ * of the image graph and weighting them by the absolute difference of the
+ * channel between their endpoints. The intersection is then
+ * computed in a single pass over a label image holding the segment of each
+ * pixel in all channels, and post processed like a single segmentation.
+ *
+ * @param k scale parameter, the same for all channels.
+ * @param graph graph of the image whose vertices are pixels in row major order,
+ * only its structure is used.
+ * @param image image to segment, typically in the L*a*b* color space.
+ * @param minCompSize minimum size of components.
+ * @param mask mask of the image.
+ * @param scaleType type of scale measure to use for segment size.
+ * @return the combined segmentation of the image.
+ */
+DisjointSetForest multiChannelFelzenszwalbSegment(int k, const WeightedGraph &graph, const Mat_<Vec3f> &image, int minCompSize, const Mat_<float> &mask, ScaleType scaleType = CARDINALITY);
+
 /**
  * Fuse small adjacent components recursively until the number of components in
  * the segmentation is smaller or equal to a given number. Can be used as a post
  * processing step to Felzenszwalb's algorithm to make sure there are few enough
- * components.
+ * components. Repeatedly merges the pair of adjacent segments with the smallest
+ * total size, using a binary heap over the edges of a dynamic region adjacency
+ * graph where the merges of each new region are queued again, so pixels are
+ * only visited to build the graph. Segments without any neighbor, such as
+ * the background, are never merged so the bound may not be reached.
  *
  * @param nbComponents the number of components to reduce the segmentation to.
  * @param segmentation "over segmentation" to reduce the number of components of.
  * @param gridGraph grid graph representing the adjacency structure between elements
  * of the segmentation. Should therefore have n vertices where n is the number of 
  * elements in the segmentation.
+ * @param merges if not NULL, receives an element of each of the 2 segments
+ * of every merge, in merge order.
  */
-//void fuseComponentsDownTo(int nbComponents, DisjointSetForest &segmentation, const WeightedGraph& gridGraph);
+void fuseComponentsDownTo(int nbComponents, DisjointSetForest &segmentation, const WeightedGraph& gridGraph, vector<pair<int,int> > *merges = NULL);
@@ -0,0 +1,300 @@
+#include "FelzenszwalbTest.h"
+
+#define TEST_IMAGE_ROWS 40
+#define TEST_IMAGE_COLS 50
+
+/**
+ * Generates a random image and a mask whose top left corner is background.
+ */
+static void randomImage(Mat_<Vec3f> &image, Mat_<float> &mask) {
+	image = Mat_<Vec3f>(TEST_IMAGE_ROWS, TEST_IMAGE_COLS);
+	mask = Mat_<float>(TEST_IMAGE_ROWS, TEST_IMAGE_COLS);
+
+	for (int i = 0; i < image.rows; i++) {
+		for (int j = 0; j < image.cols; j++) {
+			// few distinct values, so many edges have the same weight.
+			for (int c = 0; c < 3; c++) {
+				image(i,j)[c] = (float)(rand() % 8) * 10;
+			}
+			mask(i,j) = i < 5 && j < 7 ? 0.f : 1.f;
+		}
+	}
+}
+
+/**
+ * Builds the 4-connected grid graph of an image, weighted by the euclidean
+ * distance between colors.
+ */
+static WeightedGraph testGridGraph(const Mat_<Vec3f> &image) {
+	WeightedGraph grid(image.rows * image.cols, 2);
+
+	for (int i = 0; i < image.rows; i++) {
+		for (int j = 0; j < image.cols; j++) {
+			if (j + 1 < image.cols) {
+				grid.addEdge(toRowMajor(image.cols, j, i), toRowMajor(image.cols, j + 1, i), (float)norm(image(i,j) - image(i,j+1)));
+			}
+			if (i + 1 < image.rows) {
+				grid.addEdge(toRowMajor(image.cols, j, i), toRowMajor(image.cols, j, i + 1), (float)norm(image(i,j) - image(i+1,j)));
+			}
+		}
+	}
+
+	return grid;
+}
+
+/**
+ * Checks segmentations replayed from a hierarchy are the ones computed from
+ * scratch, for several scales and both scale types.
+ */
+static void testFelzenszwalbHierarchy() {
+	int scales[] = {0, 10, 50, 200, 1000};
+	ScaleType scaleTypes[] = {CARDINALITY, VOLUME};
+
+	for (int t = 0; t < 3; t++) {
+		Mat_<Vec3f> image;
+		Mat_<float> mask;
+
+		randomImage(image, mask);
+		WeightedGraph grid = testGridGraph(image);
+
+		for (int s = 0; s < 2; s++) {
+			FelzenszwalbHierarchy hierarchy(grid, mask, scaleTypes[s]);
+
+			for (int i = 0; i < 5; i++) {
+				DisjointSetForest expected = felzenszwalbSegment(scales[i], grid, 10, mask, scaleTypes[s]);
+				DisjointSetForest actual = hierarchy.segment(scales[i], 10);
+
+				assert(expected.getNumberOfComponents() == actual.getNumberOfComponents());
+				assert(segmentationAgreement(expected, actual) == 1);
+			}
+		}
+	}
+}
+
+/**
+ * Checks the multi channel segmentation is the intersection of the
+ * segmentations of each channel, post processed like a single segmentation.
+ */
+static void testMultiChannelFelzenszwalbSegment() {
+	int scales[] = {0, 10, 50, 200};
+	ScaleType scaleTypes[] = {CARDINALITY, VOLUME};
+
+	for (int t = 0; t < 3; t++) {
+		Mat_<Vec3f> image;
+		Mat_<float> mask;
+
+		randomImage(image, mask);
+		WeightedGraph grid = testGridGraph(image);
+
+		for (int s = 0; s < 2; s++) {
+			for (int i = 0; i < 4; i++) {
+				vector<DisjointSetForest> channelSegmentations;
+
+				for (int c = 0; c < 3; c++) {
+					WeightedGraph channelGraph(grid.numberOfVertices(), 2);
+
+					for (int e = 0; e < (int)grid.getEdges().size(); e++) {
+						Edge edge = grid.getEdges()[e];
+						pair<int,int> src = fromRowMajor(image.cols, edge.source);
+						pair<int,int> dst = fromRowMajor(image.cols, edge.destination);
+
+						channelGraph.addEdge(edge.source, edge.destination, (float)fabs(image(src.first, src.second)[c] - image(dst.first, dst.second)[c]));
+					}
+
+					channelSegmentations.push_back(felzenszwalbSegment(scales[i], channelGraph, 10, mask, scaleTypes[s]));
+				}
+
+				DisjointSetForest expected = combineSegmentations(grid, channelSegmentations);
+				int background = -1;
+
+				for (int p = 0; p < grid.numberOfVertices(); p++) {
+					pair<int,int> coords = fromRowMajor(image.cols, p);
+
+					if (mask(coords.first, coords.second) <= 0) {
+						background = background < 0 ? p : background;
+						expected.setUnion(background, p);
+					}
+				}
+				expected.fuseSmallComponents(mask, 10);
+
+				DisjointSetForest actual = multiChannelFelzenszwalbSegment(scales[i], grid, image, 10, mask, scaleTypes[s]);
+
+				assert(expected.getNumberOfComponents() == actual.getNumberOfComponents());
+				assert(segmentationAgreement(expected, actual) == 1);
+			}
+		}
+	}
+}
+
+/**
+ * Checks the tiled segmentation is the sequential one when the image fits
+ * in a single tile. With small tiles it stays close to it at small scales,
+ * while at large scales on noise most merges cross tile boundaries, so no
+ * bound is checked there.
+ */
+static void testTiledFelzenszwalb() {
+	int scales[] = {0, 10, 50, 200, 1000};
+	int tileSizes[] = {8, 16};
+	ScaleType scaleTypes[] = {CARDINALITY, VOLUME};
+
+	for (int t = 0; t < 3; t++) {
+		Mat_<Vec3f> image;
+		Mat_<float> mask;
+
+		randomImage(image, mask);
+		WeightedGraph grid = testGridGraph(image);
+
+		for (int s = 0; s < 2; s++) {
+			for (int i = 0; i < 5; i++) {
+				DisjointSetForest expected = felzenszwalbSegment(scales[i], grid, 10, mask, scaleTypes[s]);
+				DisjointSetForest singleTile = tiledFelzenszwalbSegment(scales[i], grid, 10, mask, max(image.rows, image.cols), scaleTypes[s]);
+
+				assert(expected.getNumberOfComponents() == singleTile.getNumberOfComponents());
+				assert(segmentationAgreement(expected, singleTile) == 1);
+
+				for (int j = 0; j < 2; j++) {
+					DisjointSetForest tiled = tiledFelzenszwalbSegment(scales[i], grid, 10, mask, tileSizes[j], scaleTypes[s]);
+
+					assert(scales[i] > 50 || segmentationAgreement(expected, tiled) > 0.98);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Builds a 4-connected grid graph where some pixels are left without edges.
+ */
+static WeightedGraph gridGraphWithHoles(int rows, int cols, int holeRate) {
+	WeightedGraph grid(rows * cols, 2);
+	vector<bool> holes(rows * cols);
+
+	for (int p = 0; p < rows * cols; p++) {
+		holes[p] = holeRate > 0 && rand() % holeRate == 0;
+	}
+
+	for (int i = 0; i < rows; i++) {
+		for (int j = 0; j < cols; j++) {
+			int p = toRowMajor(cols, j, i);
+
+			if (holes[p]) {
+				continue;
+			}
+			if (j + 1 < cols && !holes[p + 1]) {
+				grid.addEdge(p, p + 1, 1);
+			}
+			if (i + 1 < rows && !holes[p + cols]) {
+				grid.addEdge(p, p + cols, 1);
+			}
+		}
+	}
+
+	return grid;
+}
+
+/**
+ * Random over segmentation along the edges of a graph, so vertices without
+ * edges are segments without any neighbor.
+ */
+static DisjointSetForest randomOverSegmentation(const WeightedGraph &grid) {
+	DisjointSetForest segmentation(grid.numberOfVertices());
+
+	for (int e = 0; e < (int)grid.getEdges().size(); e++) {
+		if (rand() % 3 == 0) {
+			segmentation.setUnion(grid.getEdges()[e].source, grid.getEdges()[e].destination);
+		}
+	}
+
+	return segmentation;
+}
+
+/**
+ * Returns the smallest total size of 2 adjacent segments, or -1 if no
+ * segments are adjacent, by going through all pairs of segments.
+ */
+static int smallestAdjacentPair(DisjointSetForest &segmentation, const WeightedGraph &grid) {
+	const vector<int> &segmentIndexes = segmentation.getSegmentIndexes();
+	const vector<int> &segmentRoots = segmentation.getSegmentRoots();
+	int nbSegments = (int)segmentRoots.size();
+	vector<vector<bool> > adjacent(nbSegments, vector<bool>(nbSegments, false));
+	int smallest = -1;
+
+	for (int e = 0; e < (int)grid.getEdges().size(); e++) {
+		int s1 = segmentIndexes[grid.getEdges()[e].source];
+		int s2 = segmentIndexes[grid.getEdges()[e].destination];
+
+		adjacent[s1][s2] = true;
+		adjacent[s2][s1] = true;
+	}
+
+	for (int s1 = 0; s1 < nbSegments; s1++) {
+		for (int s2 = s1 + 1; s2 < nbSegments; s2++) {
+			int size = segmentation.getComponentSize(segmentRoots[s1]) + segmentation.getComponentSize(segmentRoots[s2]);
+
+			if (adjacent[s1][s2] && (smallest < 0 || size < smallest)) {
+				smallest = size;
+			}
+		}
+	}
+
+	return smallest;
+}
+
+/**
+ * Checks each merge of fuseComponentsDownTo is one of the adjacent pairs of
+ * segments of smallest total size, by replaying merges on the initial
+ * segmentation. Merges go on until there are few enough segments, or no
+ * adjacent ones, and segments without neighbor are never merged.
+ */
+static void testFuseComponentsDownTo() {
+	for (int t = 0; t < 100; t++) {
+		int rows = 5 + rand() % 10;
+		int cols = 5 + rand() % 10;
+		// even tests run on connected grids.
+		int holeRate = t % 2 == 0 ? 0 : 2 + rand() % 8;
+		WeightedGraph grid = gridGraphWithHoles(rows, cols, holeRate);
+		DisjointSetForest initial = randomOverSegmentation(grid);
+
+		int nbComponents = 1 + rand() % initial.getNumberOfComponents();
+		DisjointSetForest fused = initial;
+		DisjointSetForest replayed = initial;
+		vector<pair<int,int> > merges;
+
+		fuseComponentsDownTo(nbComponents, fused, grid, &merges);
+
+		for (int m = 0; m < (int)merges.size(); m++) {
+			int root1 = replayed.find(merges[m].first);
+			int root2 = replayed.find(merges[m].second);
+			int size = replayed.getComponentSize(root1) + replayed.getComponentSize(root2);
+
+			assert(root1 != root2);
+			assert(size == smallestAdjacentPair(replayed, grid));
+
+			bool adjacent = false;
+
+			for (int e = 0; e < (int)grid.getEdges().size() && !adjacent; e++) {
+				int src = replayed.find(grid.getEdges()[e].source);
+				int dst = replayed.find(grid.getEdges()[e].destination);
+
+				adjacent = (src == root1 && dst == root2) || (src == root2 && dst == root1);
+			}
+			assert(adjacent);
+			replayed.setUnion(root1, root2);
+		}
+
+		assert(segmentationAgreement(replayed, fused) == 1);
+		assert(fused.getNumberOfComponents() <= nbComponents || smallestAdjacentPair(fused, grid) < 0);
+		assert(holeRate > 0 || fused.getNumberOfComponents() <= nbComponents);
+
+		for (int p = 0; p < grid.numberOfVertices(); p++) {
+			assert(grid.degree(p) > 0 || fused.getComponentSize(p) == 1);
+		}
+	}
+}
+
+void testFelzenszwalb() {
+	testFelzenszwalbHierarchy();
+	testMultiChannelFelzenszwalbSegment();
+	testTiledFelzenszwalb();
+	testFuseComponentsDownTo();
+}
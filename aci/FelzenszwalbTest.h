@@ -0,0 +1,10 @@
+/** @file */
+#pragma once
+
+#include "Felzenszwalb.hpp"
+#include "Utils.hpp"
+
+using namespace cv;
+using namespace std;
+
+void testFelzenszwalb();
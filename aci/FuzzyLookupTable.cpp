@@ -0,0 +1,162 @@
+#include "FuzzyLookupTable.h"
+
+#include <random>
+
+static fl::scalar processEngine(fl::Engine *engine, const vector<fl::InputVariable*> &inputs, fl::OutputVariable *output, float x, float y, float z) {
+	inputs[0]->setInput(x);
+	inputs[1]->setInput(y);
+	inputs[2]->setInput(z);
+	engine->process();
+
+	return output->defuzzify();
+}
+
+FuzzyLookupTable::FuzzyLookupTable()
+	: resolution(0)
+{
+
+}
+
+void FuzzyLookupTable::setGrid(const float *minimums, const float *maximums, int resolution) {
+	assert(resolution >= 2);
+	this->resolution = resolution;
+
+	for (int d = 0; d < 3; d++) {
+		assert(maximums[d] > minimums[d]);
+		this->minimums[d] = minimums[d];
+		this->steps[d] = (maximums[d] - minimums[d]) / (float)(resolution - 1);
+	}
+
+	this->values.resize(resolution * resolution * resolution);
+}
+
+void FuzzyLookupTable::compile(fl::Engine *engine, const vector<fl::InputVariable*> &inputs, fl::OutputVariable *output, int resolution) {
+	assert(inputs.size() == 3);
+	float minimums[3], maximums[3];
+
+	for (int d = 0; d < 3; d++) {
+		minimums[d] = (float)inputs[d]->getMinimum();
+		maximums[d] = (float)inputs[d]->getMaximum();
+	}
+
+	this->setGrid(minimums, maximums, resolution);
+
+	for (int i = 0; i < resolution; i++) {
+		for (int j = 0; j < resolution; j++) {
+			for (int k = 0; k < resolution; k++) {
+				this->values[(i * resolution + j) * resolution + k] = (float)processEngine(
+					engine, inputs, output,
+					this->minimums[0] + i * this->steps[0],
+					this->minimums[1] + j * this->steps[1],
+					this->minimums[2] + k * this->steps[2]);
+			}
+		}
+	}
+}
+
+void FuzzyLookupTable::compile(float (*function)(float, float, float), const float *minimums, const float *maximums, int resolution) {
+	this->setGrid(minimums, maximums, resolution);
+
+	for (int i = 0; i < resolution; i++) {
+		for (int j = 0; j < resolution; j++) {
+			for (int k = 0; k < resolution; k++) {
+				this->values[(i * resolution + j) * resolution + k] = function(
+					this->minimums[0] + i * this->steps[0],
+					this->minimums[1] + j * this->steps[1],
+					this->minimums[2] + k * this->steps[2]);
+			}
+		}
+	}
+}
+
+bool FuzzyLookupTable::isCompiled() const {
+	return this->resolution > 0;
+}
+
+int FuzzyLookupTable::getResolution() const {
+	return this->resolution;
+}
+
+float FuzzyLookupTable::minimum() const {
+	assert(this->isCompiled());
+
+	return *min_element(this->values.begin(), this->values.end());
+}
+
+void FuzzyLookupTable::locate(int dimension, float value, int &cell, float &position) const {
+	float coordinate = (value - this->minimums[dimension]) / this->steps[dimension];
+
+	if (!(coordinate > 0)) {
+		cell = 0;
+		position = 0;
+	} else if (coordinate >= this->resolution - 1) {
+		cell = this->resolution - 2;
+		position = 1;
+	} else {
+		cell = (int)coordinate;
+		position = coordinate - cell;
+	}
+}
+
+float FuzzyLookupTable::evaluate(float x, float y, float z) const {
+	assert(this->isCompiled());
+	int i, j, k;
+	float u, v, w;
+
+	this->locate(0, x, i, u);
+	this->locate(1, y, j, v);
+	this->locate(2, z, k, w);
+
+	int r = this->resolution;
+	const float *corner = &this->values[(i * r + j) * r + k];
+	// interpolates along the last input, then the second, then the first.
+	float c00 = corner[0] + w * (corner[1] - corner[0]);
+	float c01 = corner[r] + w * (corner[r + 1] - corner[r]);
+	float c10 = corner[r * r] + w * (corner[r * r + 1] - corner[r * r]);
+	float c11 = corner[r * r + r] + w * (corner[r * r + r + 1] - corner[r * r + r]);
+	float c0 = c00 + v * (c01 - c00);
+	float c1 = c10 + v * (c11 - c10);
+
+	return c0 + u * (c1 - c0);
+}
+
+void FuzzyLookupTable::evaluate(const MatrixXd &x, const MatrixXd &y, const MatrixXd &z, MatrixXd &result) const {
+	assert(x.rows() == y.rows() && x.rows() == z.rows() && x.cols() == y.cols() && x.cols() == z.cols());
+	result.resize(x.rows(), x.cols());
+
+	for (int j = 0; j < (int)x.cols(); j++) {
+		for (int i = 0; i < (int)x.rows(); i++) {
+			result(i,j) = this->evaluate((float)x(i,j), (float)y(i,j), (float)z(i,j));
+		}
+	}
+}
+
+double FuzzyLookupTable::maxError(fl::Engine *engine, const vector<fl::InputVariable*> &inputs, fl::OutputVariable *output, int randomSamples) const {
+	assert(this->isCompiled());
+	double error = 0;
+	int cells = this->resolution - 1;
+	mt19937 generator(42);
+	uniform_real_distribution<float> unit(0, 1);
+
+	for (int i = 0; i < cells; i++) {
+		for (int j = 0; j < cells; j++) {
+			for (int k = 0; k < cells; k++) {
+				float x = this->minimums[0] + (i + 0.5f) * this->steps[0];
+				float y = this->minimums[1] + (j + 0.5f) * this->steps[1];
+				float z = this->minimums[2] + (k + 0.5f) * this->steps[2];
+
+				error = max(error, fabs(processEngine(engine, inputs, output, x, y, z) - this->evaluate(x, y, z)));
+			}
+		}
+	}
+
+	for (int s = 0; s < randomSamples; s++) {
+		float x = this->minimums[0] + cells * this->steps[0] * unit(generator);
+		float y = this->minimums[1] + cells * this->steps[1] * unit(generator);
+		float z = this->minimums[2] + cells * this->steps[2] * unit(generator);
+
+		error = max(error, fabs(processEngine(engine, inputs, output, x, y, z) - this->evaluate(x, y, z)));
+	}
+
+	return error;
+}
@@ -0,0 +1,102 @@
+/** @file */
+#pragma once
+
+#include <vector>
+#include <Eigen/Dense>
+#include <fl/Headers.h>
+
+using namespace std;
+using namespace Eigen;
+
+/**
+ * Precompiled fuzzy inference system with 3 inputs and 1 output. The
+ * engine is sampled once on a regular grid over the ranges of its inputs,
+ * then evaluated by trilinear interpolation, which is much cheaper than
+ * running Mamdani inference and numerically integrating the output
+ * membership for each query. The engine's output being a continuous
+ * function of its inputs, the error decreases with the resolution; use
+ * maxError to check it for a given rule base.
+ */
+class FuzzyLookupTable {
+private:
+	int resolution;
+	float minimums[3];
+	float steps[3];
+	// values at grid points, the last input varying fastest.
+	vector<float> values;
+
+	/**
+	 * Returns the index of the cell containing a value along a dimension
+	 * and the position of the value inside it, in [0;1].
+	 */
+	void locate(int dimension, float value, int &cell, float &position) const;
+
+	/**
+	 * Sets the ranges and resolution of the grid, and allocates its values.
+	 */
+	void setGrid(const float *minimums, const float *maximums, int resolution);
+
+public:
+	FuzzyLookupTable();
+
+	/**
+	 * Samples an engine on a resolution^3 grid.
+	 *
+	 * @param engine configured engine to sample.
+	 * @param inputs the 3 input variables of the engine, in the order
+	 * evaluation arguments are given.
+	 * @param output output variable of the engine.
+	 * @param resolution number of samples along each input, at least 2.
+	 */
+	void compile(fl::Engine *engine, const vector<fl::InputVariable*> &inputs, fl::OutputVariable *output, int resolution);
+
+	/**
+	 * Samples a function of 3 variables on a resolution^3 grid.
+	 *
+	 * @param function function to sample.
+	 * @param minimums lower bounds of the 3 variables.
+	 * @param maximums upper bounds of the 3 variables.
+	 * @param resolution number of samples along each variable, at least 2.
+	 */
+	void compile(float (*function)(float, float, float), const float *minimums, const float *maximums, int resolution);
+
+	bool isCompiled() const;
+
+	int getResolution() const;
+
+	/**
+	 * Returns the minimum value of the table. Interpolated values being
+	 * convex combinations of grid values, it is a lower bound of evaluate.
+	 */
+	float minimum() const;
+
+	/**
+	 * Evaluates the table for one set of inputs, clamped to their ranges.
+	 */
+	float evaluate(float x, float y, float z) const;
+
+	/**
+	 * Evaluates the table for matrices of inputs, coefficient-wise.
+	 *
+	 * @param x values of the first input.
+	 * @param y values of the second input, of the same size as x.
+	 * @param z values of the third input, of the same size as x.
+	 * @param result output matrix of the value for each coefficient.
+	 */
+	void evaluate(const MatrixXd &x, const MatrixXd &y, const MatrixXd &z, MatrixXd &result) const;
+
+	/**
+	 * Computes the maximum absolute difference between the table and the
+	 * engine it was compiled from, at the centers of the grid cells and at
+	 * random points, where interpolation error is the largest. Random
+	 * points are drawn from a local generator with a fixed seed, so the
+	 * result is reproducible and the state of rand() is left untouched.
+	 *
+	 * @param engine engine the table was compiled from.
+	 * @param inputs the input variables of the engine.
+	 * @param output the output variable of the engine.
+	 * @param randomSamples number of random points to check.
+	 * @return the maximum error found.
+	 */
+	double maxError(fl::Engine *engine, const vector<fl::InputVariable*> &inputs, fl::OutputVariable *output, int randomSamples = 1000) const;
+};
@@ -0,0 +1,164 @@
+#include "FuzzyLookupTableTest.h"
+
+// maximum difference between the similarity table of the classifier at its
+// default resolution and its fuzzy engine. The rules use minimum and
+// maximum, so the engine has kinks the table smoothes out, and the error
+// only decreases linearly with the resolution: it is about 0.04 at 33.
+#define SIMILARITY_TABLE_TOLERANCE 0.05
+
+static float randomFloat(float min, float max) {
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+static float clamp(float value, float min, float max) {
+	return value < min ? min : (value > max ? max : value);
+}
+
+/**
+ * Function linear along each variable, which trilinear interpolation
+ * reproduces exactly.
+ */
+static float trilinear(float x, float y, float z) {
+	return 1.5f - 2 * x + 0.5f * y + 3 * z + x * y - 0.25f * y * z + 2 * x * z - 0.5f * x * y * z;
+}
+
+/**
+ * Checks interpolation reproduces a trilinear function inside the grid, and
+ * its values at the clamped inputs outside of it.
+ */
+static void testTrilinearInterpolation() {
+	float minimums[] = {-1, 0, 10};
+	float maximums[] = {2, 5, 11};
+	int resolutions[] = {2, 3, 8, 33};
+
+	for (int r = 0; r < 4; r++) {
+		FuzzyLookupTable table;
+		assert(!table.isCompiled());
+
+		table.compile(trilinear, minimums, maximums, resolutions[r]);
+		assert(table.isCompiled());
+		assert(table.getResolution() == resolutions[r]);
+
+		for (int s = 0; s < 1000; s++) {
+			float x = randomFloat(minimums[0] - 1, maximums[0] + 1);
+			float y = randomFloat(minimums[1] - 1, maximums[1] + 1);
+			float z = randomFloat(minimums[2] - 1, maximums[2] + 1);
+			float expected = trilinear(
+				clamp(x, minimums[0], maximums[0]),
+				clamp(y, minimums[1], maximums[1]),
+				clamp(z, minimums[2], maximums[2]));
+
+			assert(fabs(table.evaluate(x, y, z) - expected) < 1E-3 * (1 + fabs(expected)));
+		}
+
+		// matrix evaluation agrees with scalar evaluation.
+		MatrixXd x(3, 4), y(3, 4), z(3, 4), result;
+
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 4; j++) {
+				x(i,j) = randomFloat(minimums[0], maximums[0]);
+				y(i,j) = randomFloat(minimums[1], maximums[1]);
+				z(i,j) = randomFloat(minimums[2], maximums[2]);
+			}
+		}
+		table.evaluate(x, y, z, result);
+
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 4; j++) {
+				assert(result(i,j) == table.evaluate((float)x(i,j), (float)y(i,j), (float)z(i,j)));
+			}
+		}
+	}
+}
+
+static fl::InputVariable *lowHighInput(const string &name, double minimum, double maximum) {
+	fl::InputVariable *input = new fl::InputVariable();
+	input->setName(name);
+	input->setRange(minimum, maximum);
+	input->addTerm(new fl::Triangle("LOW", minimum, minimum, maximum));
+	input->addTerm(new fl::Triangle("HIGH", minimum, maximum, maximum));
+
+	return input;
+}
+
+/**
+ * Checks the table at grid points against running the engine it was
+ * compiled from, with inputs over different ranges.
+ */
+static void testGridPointsMatchEngine() {
+	fl::Engine engine("lookup-table-test");
+	vector<fl::InputVariable*> inputs;
+	inputs.push_back(lowHighInput("X", 0, 1));
+	inputs.push_back(lowHighInput("Y", -2, 3));
+	inputs.push_back(lowHighInput("Z", 10, 20));
+
+	for (int d = 0; d < 3; d++) {
+		engine.addInputVariable(inputs[d]);
+	}
+
+	fl::OutputVariable *output = new fl::OutputVariable();
+	output->setName("Out");
+	output->setRange(0, 1);
+	output->setDefaultValue(0);
+	output->addTerm(new fl::Triangle("LOW", 0, 0, 0.5));
+	output->addTerm(new fl::Triangle("MEDIUM", 0, 0.5, 1));
+	output->addTerm(new fl::Triangle("HIGH", 0.5, 1, 1));
+	engine.addOutputVariable(output);
+
+	// at least one rule fires for any input.
+	fl::RuleBlock *rules = new fl::RuleBlock();
+	rules->addRule(fl::MamdaniRule::parse("if X is LOW then Out is LOW", &engine));
+	rules->addRule(fl::MamdaniRule::parse("if X is HIGH and Y is HIGH then Out is HIGH", &engine));
+	rules->addRule(fl::MamdaniRule::parse("if Y is LOW or Z is HIGH then Out is MEDIUM", &engine));
+	engine.addRuleBlock(rules);
+	engine.configure("Minimum", "Maximum", "AlgebraicProduct", "AlgebraicSum", "Centroid");
+
+	int resolution = 5;
+	FuzzyLookupTable table;
+	table.compile(&engine, inputs, output, resolution);
+
+	for (int i = 0; i < resolution; i++) {
+		for (int j = 0; j < resolution; j++) {
+			for (int k = 0; k < resolution; k++) {
+				float point[3];
+				int indices[] = {i, j, k};
+
+				for (int d = 0; d < 3; d++) {
+					point[d] = (float)(inputs[d]->getMinimum() + indices[d] * (inputs[d]->getMaximum() - inputs[d]->getMinimum()) / (resolution - 1));
+					inputs[d]->setInput(point[d]);
+				}
+				engine.process();
+				fl::scalar expected = output->defuzzify();
+
+				assert(fabs(table.evaluate(point[0], point[1], point[2]) - expected) < 1E-5);
+			}
+		}
+	}
+
+	// the error is 0 at grid points only.
+	assert(table.maxError(&engine, inputs, output, 100) > 0);
+	assert(table.maxError(&engine, inputs, output, 100) == table.maxError(&engine, inputs, output, 100));
+}
+
+/**
+ * Checks the similarity table of the classifier at its default resolution
+ * against its fuzzy engine, and that doing so leaves the state of rand()
+ * untouched.
+ */
+static void testSimilarityTableError() {
+	MatchingSegmentClassifier classifier;
+
+	srand(7);
+	int expected = rand();
+	srand(7);
+	double error = classifier.similarityTableError();
+
+	assert(rand() == expected);
+	assert(error < SIMILARITY_TABLE_TOLERANCE);
+}
+
+void testFuzzyLookupTable() {
+	testTrilinearInterpolation();
+	testGridPointsMatchEngine();
+	testSimilarityTableError();
+}
@@ -0,0 +1,11 @@
+/** @file */
+#pragma once
+
+#include <cassert>
+
+#include "FuzzyLookupTable.h"
+#include "MatchingSegmentsClassifier.h"
+
+using namespace std;
+
+void testFuzzyLookupTable();
@@ -0,0 +1,65 @@
+#include "GraphArena.hpp"
+
+GraphArena::GraphArena(size_t blockSize)
+	: blockSize(blockSize), current(NULL), remaining(0), bytesAllocated(0)
+{
+
+}
+
+GraphArena::~GraphArena() {
+	this->release();
+}
+
+void *GraphArena::allocate(size_t bytes, size_t alignment) {
+	size_t padding = (alignment - ((size_t)this->current & (alignment - 1))) & (alignment - 1);
+
+	if (this->current == NULL || padding + bytes > this->remaining) {
+		// requests larger than a block get their own, leaving the current
+		// block available for subsequent small requests.
+		if (bytes + alignment > this->blockSize) {
+			char *dedicated = (char*)malloc(bytes + alignment);
+
+			if (dedicated == NULL) {
+				throw bad_alloc();
+			}
+			this->blocks.push_back(dedicated);
+			this->bytesAllocated += bytes;
+			size_t dedicatedPadding = (alignment - ((size_t)dedicated & (alignment - 1))) & (alignment - 1);
+
+			return dedicated + dedicatedPadding;
+		}
+
+		char *block = (char*)malloc(this->blockSize);
+
+		if (block == NULL) {
+			throw bad_alloc();
+		}
+		this->blocks.push_back(block);
+		this->current = block;
+		this->remaining = this->blockSize;
+		padding = (alignment - ((size_t)this->current & (alignment - 1))) & (alignment - 1);
+	}
+
+	void *chunk = this->current + padding;
+
+	this->current += padding + bytes;
+	this->remaining -= padding + bytes;
+	this->bytesAllocated += bytes;
+
+	return chunk;
+}
+
+void GraphArena::release() {
+	for (int i = 0; i < (int)this->blocks.size(); i++) {
+		free(this->blocks[i]);
+	}
+
+	this->blocks.clear();
+	this->current = NULL;
+	this->remaining = 0;
+	this->bytesAllocated = 0;
+}
+
+size_t GraphArena::getBytesAllocated() const {
+	return this->bytesAllocated;
+}
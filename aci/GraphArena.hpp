@@ -0,0 +1,144 @@
+/** @file */
+/**
+ * Monotonic memory arena for short lived graphs. Memory is handed out
+ * by bumping a pointer into large blocks, and is only given back all at
+ * once when the arena is released or destroyed. This makes the many small
+ * adjacency list allocations done when building a graph for an image
+ * essentially free, at the cost of never reusing memory before release.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <limits>
+#include <vector>
+
+using namespace std;
+
+#define DEFAULT_ARENA_BLOCK_SIZE (1 << 20)
+
+class GraphArena {
+private:
+  vector<char*> blocks;
+  size_t blockSize;
+  char *current;
+  size_t remaining;
+  size_t bytesAllocated;
+
+  // an arena owns its blocks, so it cannot be copied.
+  GraphArena(const GraphArena &arena);
+  GraphArena &operator=(const GraphArena &arena);
+
+public:
+  /**
+   * Initializes an empty arena. No memory is allocated until the first
+   * call to allocate.
+   *
+   * @param blockSize size in bytes of the blocks the arena allocates from
+   * the system. Requests larger than this get a block of their own.
+   */
+  GraphArena(size_t blockSize = DEFAULT_ARENA_BLOCK_SIZE);
+  ~GraphArena();
+
+  /**
+   * Allocates a chunk of memory from the arena. The memory stays valid until
+   * the arena is released or destroyed.
+   *
+   * @param bytes the number of bytes to allocate.
+   * @param alignment required alignment of the chunk, must be a power of 2.
+   * @return a pointer to the allocated chunk.
+   */
+  void *allocate(size_t bytes, size_t alignment);
+  /**
+   * Frees all the memory allocated from the arena in one step. Every object
+   * allocated from the arena must have been destroyed beforehand.
+   */
+  void release();
+  /**
+   * Returns the number of bytes handed out by the arena since the last release.
+   */
+  size_t getBytesAllocated() const;
+};
+
+/**
+ * STL allocator drawing from a GraphArena. Deallocation is a no-op, the memory
+ * being reclaimed when the arena is released. A null arena falls back to the
+ * global operator new, so containers using this allocator behave exactly like
+ * standard ones when no arena is specified.
+ */
+template < typename T >
+class ArenaAllocator {
+public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template < typename U >
+  struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+  GraphArena *arena;
+
+  ArenaAllocator(GraphArena *arena = NULL)
+    : arena(arena)
+  {
+
+  }
+
+  template < typename U >
+  ArenaAllocator(const ArenaAllocator<U> &other)
+    : arena(other.arena)
+  {
+
+  }
+
+  pointer address(reference x) const {
+    return &x;
+  }
+
+  const_pointer address(const_reference x) const {
+    return &x;
+  }
+
+  pointer allocate(size_type n, const void * = 0) {
+    if (this->arena == NULL) {
+      return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+
+    return static_cast<pointer>(this->arena->allocate(n * sizeof(T), __alignof(T)));
+  }
+
+  void deallocate(pointer p, size_type) {
+    if (this->arena == NULL) {
+      ::operator delete(p);
+    }
+  }
+
+  size_type max_size() const {
+    return numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+  void construct(pointer p, const T &value) {
+    new((void*)p) T(value);
+  }
+
+  void destroy(pointer p) {
+    p->~T();
+  }
+};
+
+template < typename T, typename U >
+bool operator==(const ArenaAllocator<T> &a1, const ArenaAllocator<U> &a2) {
+  return a1.arena == a2.arena;
+}
+
+template < typename T, typename U >
+bool operator!=(const ArenaAllocator<T> &a1, const ArenaAllocator<U> &a2) {
+  return a1.arena != a2.arena;
+}
@@ -0,0 +1,271 @@
+#include "GraphSerialization.h"
+
+size_t graphFileLabelsOffset(int numberOfEdges) {
+	size_t end = sizeof(GraphFileHeader) + (size_t)numberOfEdges * sizeof(Edge);
+
+	return (end + 7) & ~(size_t)7;
+}
+
+void writeGraphFileHeader(ofstream &out, GraphFileKind kind, const WeightedGraph &graph, int labelSize) {
+	GraphFileHeader header;
+
+	memcpy(header.magic, GRAPH_FILE_MAGIC, 4);
+	header.version = GRAPH_FILE_VERSION;
+	header.kind = kind;
+	header.numberOfVertices = graph.numberOfVertices();
+	header.numberOfEdges = graph.getEdges().size();
+	header.labelSize = labelSize;
+
+	out.write((const char*)&header, sizeof(GraphFileHeader));
+
+	if (!graph.getEdges().empty()) {
+		out.write((const char*)&graph.getEdges()[0], graph.getEdges().size() * sizeof(Edge));
+	}
+}
+
+bool saveWeightedGraph(const WeightedGraph &graph, const string &filename) {
+	ofstream out(filename.c_str(), ios::out | ios::binary);
+
+	if (!out) {
+		return false;
+	}
+
+	writeGraphFileHeader(out, WEIGHTED_GRAPH_FILE, graph, 0);
+
+	return out.good();
+}
+
+bool saveSegmentation(DisjointSetForest &segmentation, const string &filename) {
+	ofstream out(filename.c_str(), ios::out | ios::binary);
+
+	if (!out) {
+		return false;
+	}
+
+	int n = segmentation.getNumberOfElements();
+	GraphFileHeader header;
+
+	memcpy(header.magic, GRAPH_FILE_MAGIC, 4);
+	header.version = GRAPH_FILE_VERSION;
+	header.kind = SEGMENTATION_FILE;
+	header.numberOfVertices = n;
+	header.numberOfEdges = segmentation.getNumberOfComponents();
+	header.labelSize = 0;
+
+	vector<int> roots(n);
+	vector<int> componentSizes(n, 0);
+
+	for (int i = 0; i < n; i++) {
+		roots[i] = segmentation.find(i);
+
+		if (roots[i] == i) {
+			componentSizes[i] = segmentation.getComponentSize(i);
+		}
+	}
+
+	out.write((const char*)&header, sizeof(GraphFileHeader));
+
+	if (n > 0) {
+		out.write((const char*)&roots[0], n * sizeof(int));
+		out.write((const char*)&componentSizes[0], n * sizeof(int));
+	}
+
+	return out.good();
+}
+
+/**
+ * Adds the size of an array of count elements to a file size, failing if
+ * the count is negative or the size overflows.
+ */
+static bool addArraySize(size_t &size, int count, size_t elementSize) {
+	if (count < 0 || (size_t)count > (numeric_limits<size_t>::max() - size) / elementSize) {
+		return false;
+	}
+	size += (size_t)count * elementSize;
+
+	return true;
+}
+
+/**
+ * Checks the endpoints of mapped edges are vertices of the graph.
+ */
+static bool validEdges(const Edge *edges, int numberOfEdges, int numberOfVertices) {
+	for (int i = 0; i < numberOfEdges; i++) {
+		if (edges[i].source < 0 || edges[i].source >= numberOfVertices
+			|| edges[i].destination < 0 || edges[i].destination >= numberOfVertices) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Checks mapped roots form a valid forest of depth at most 1 whose number
+ * of components and component sizes match the header.
+ */
+static bool validSegmentation(const int *roots, const int *componentSizes, int numberOfElements, int numberOfComponents) {
+	vector<int> actualSizes(numberOfElements, 0);
+	int actualComponents = 0;
+
+	for (int i = 0; i < numberOfElements; i++) {
+		if (roots[i] < 0 || roots[i] >= numberOfElements || roots[roots[i]] != roots[i]) {
+			return false;
+		}
+		actualSizes[roots[i]]++;
+
+		if (roots[i] == i) {
+			actualComponents++;
+		}
+	}
+
+	for (int i = 0; i < numberOfElements; i++) {
+		if (roots[i] == i && componentSizes[i] != actualSizes[i]) {
+			return false;
+		}
+	}
+
+	return actualComponents == numberOfComponents;
+}
+
+MappedGraphFile::MappedGraphFile()
+	: header(NULL)
+{
+
+}
+
+const char *MappedGraphFile::data() const {
+	return (const char*)this->region.get_address();
+}
+
+bool MappedGraphFile::open(const string &filename) {
+	this->close();
+
+	try {
+		boost::interprocess::file_mapping file(filename.c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region region(file, boost::interprocess::read_only);
+
+		this->file.swap(file);
+		this->region.swap(region);
+	} catch (boost::interprocess::interprocess_exception &) {
+		return false;
+	}
+
+	const GraphFileHeader *header = (const GraphFileHeader*)this->data();
+
+	if (this->region.get_size() < sizeof(GraphFileHeader)
+		|| memcmp(header->magic, GRAPH_FILE_MAGIC, 4) != 0
+		|| header->version != GRAPH_FILE_VERSION) {
+		this->close();
+		return false;
+	}
+
+	// checks the file is large enough for the arrays the header announces,
+	// and that their content is consistent, so a corrupted or truncated file
+	// is rejected rather than read out of bounds.
+	size_t expectedSize = sizeof(GraphFileHeader);
+	bool valid = header->numberOfVertices >= 0 && header->numberOfEdges >= 0;
+
+	switch (header->kind) {
+	case WEIGHTED_GRAPH_FILE:
+		valid = valid && addArraySize(expectedSize, header->numberOfEdges, sizeof(Edge));
+		break;
+	case LABELED_GRAPH_FILE:
+		valid = valid && header->labelSize > 0
+			&& addArraySize(expectedSize, header->numberOfEdges, sizeof(Edge))
+			&& expectedSize <= numeric_limits<size_t>::max() - 7;
+
+		if (valid) {
+			expectedSize = graphFileLabelsOffset(header->numberOfEdges);
+			valid = addArraySize(expectedSize, header->numberOfVertices, header->labelSize);
+		}
+		break;
+	case SEGMENTATION_FILE:
+		valid = valid && addArraySize(expectedSize, header->numberOfVertices, sizeof(int))
+			&& addArraySize(expectedSize, header->numberOfVertices, sizeof(int));
+		break;
+	default:
+		valid = false;
+	}
+
+	valid = valid && this->region.get_size() >= expectedSize;
+
+	if (valid && header->kind == SEGMENTATION_FILE) {
+		const int *roots = (const int*)(this->data() + sizeof(GraphFileHeader));
+
+		valid = validSegmentation(roots, roots + header->numberOfVertices, header->numberOfVertices, header->numberOfEdges);
+	} else if (valid) {
+		valid = validEdges((const Edge*)(this->data() + sizeof(GraphFileHeader)), header->numberOfEdges, header->numberOfVertices);
+	}
+
+	if (!valid) {
+		this->close();
+		return false;
+	}
+
+	this->header = header;
+
+	return true;
+}
+
+void MappedGraphFile::close() {
+	boost::interprocess::mapped_region emptyRegion;
+	boost::interprocess::file_mapping emptyFile;
+
+	this->region.swap(emptyRegion);
+	this->file.swap(emptyFile);
+	this->header = NULL;
+}
+
+bool MappedGraphFile::isOpen() const {
+	return this->header != NULL;
+}
+
+GraphFileKind MappedGraphFile::getKind() const {
+	assert(this->isOpen());
+
+	return (GraphFileKind)this->header->kind;
+}
+
+int MappedGraphFile::numberOfVertices() const {
+	assert(this->isOpen());
+
+	return this->header->numberOfVertices;
+}
+
+int MappedGraphFile::numberOfEdges() const {
+	assert(this->isOpen());
+
+	return this->header->numberOfEdges;
+}
+
+const Edge *MappedGraphFile::getEdges() const {
+	assert(this->getKind() == WEIGHTED_GRAPH_FILE || this->getKind() == LABELED_GRAPH_FILE);
+
+	return (const Edge*)(this->data() + sizeof(GraphFileHeader));
+}
+
+const int *MappedGraphFile::getRoots() const {
+	assert(this->getKind() == SEGMENTATION_FILE);
+
+	return (const int*)(this->data() + sizeof(GraphFileHeader));
+}
+
+const int *MappedGraphFile::getComponentSizes() const {
+	return this->getRoots() + this->numberOfVertices();
+}
+
+WeightedGraph MappedGraphFile::toWeightedGraph(int maxDegree, GraphArena *arena) const {
+	WeightedGraph graph(this->numberOfVertices(), maxDegree, arena);
+	const Edge *edges = this->getEdges();
+
+	for (int i = 0; i < this->numberOfEdges(); i++) {
+		graph.addEdge(edges[i].source, edges[i].destination, edges[i].weight);
+	}
+
+	return graph;
+}
+
+DisjointSetForest MappedGraphFile::toSegmentation() const {
+	return DisjointSetForest(this->numberOfVertices(), this->getRoots(), this->getComponentSizes());
+}
@@ -0,0 +1,221 @@
+/** @file */
+/**
+ * Versioned binary format for graphs and segmentations, designed to be
+ * memory mapped and read in place so cached graphs can be shared across
+ * processes and runs without any parsing. A file consists of a fixed size
+ * header followed by raw arrays in native byte order, so files are only
+ * portable between machines of the same architecture:
+ * - weighted graph: header, edge list.
+ * - labeled graph: header, edge list, padding to 8 bytes, vertex labels.
+ * - segmentation: header, root of each element, size of each root's set.
+ */
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <limits>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "WeightedGraph.hpp"
+#include "LabeledGraph.hpp"
+#include "DisjointSet.hpp"
+
+using namespace std;
+
+#define GRAPH_FILE_MAGIC "ACIG"
+#define GRAPH_FILE_VERSION 1
+
+/**
+ * Type of the content of a graph file.
+ */
+enum GraphFileKind { WEIGHTED_GRAPH_FILE = 0, LABELED_GRAPH_FILE = 1, SEGMENTATION_FILE = 2 };
+
+/**
+ * Header at the start of every graph file.
+ */
+struct GraphFileHeader {
+	char magic[4];
+	int version;
+	int kind;
+	// number of vertices of a graph, or elements of a segmentation.
+	int numberOfVertices;
+	// number of edges of a graph, or components of a segmentation.
+	int numberOfEdges;
+	// size in bytes of a vertex label, 0 if there are none.
+	int labelSize;
+};
+
+/**
+ * Returns the offset in bytes of the vertex labels in a labeled graph file.
+ *
+ * @param numberOfEdges the number of edges of the graph.
+ * @return the offset of the labels from the start of the file.
+ */
+size_t graphFileLabelsOffset(int numberOfEdges);
+
+/**
+ * Writes the header and edge list of a graph to an output stream.
+ */
+void writeGraphFileHeader(ofstream &out, GraphFileKind kind, const WeightedGraph &graph, int labelSize);
+
+/**
+ * Saves a weighted graph to a binary graph file.
+ *
+ * @param graph graph to save.
+ * @param filename name of the file to write.
+ * @return true iff the file was successfully written.
+ */
+bool saveWeightedGraph(const WeightedGraph &graph, const string &filename);
+
+/**
+ * Saves a labeled graph to a binary graph file. Labels are written as raw
+ * bytes, so the label type must be trivially copyable (Matx, Vec, scalars...)
+ * - in particular it cannot be Mat.
+ *
+ * @param graph graph to save.
+ * @param filename name of the file to write.
+ * @return true iff the file was successfully written.
+ */
+template < typename T >
+bool saveLabeledGraph(const LabeledGraph<T> &graph, const string &filename) {
+	ofstream out(filename.c_str(), ios::out | ios::binary);
+
+	if (!out) {
+		return false;
+	}
+
+	writeGraphFileHeader(out, LABELED_GRAPH_FILE, graph, sizeof(T));
+
+	size_t padding = graphFileLabelsOffset(graph.getEdges().size()) - sizeof(GraphFileHeader) - graph.getEdges().size() * sizeof(Edge);
+	char zeros[8] = {0};
+
+	out.write(zeros, padding);
+
+	for (int i = 0; i < graph.numberOfVertices(); i++) {
+		T label = graph.getLabel(i);
+
+		out.write((const char*)&label, sizeof(T));
+	}
+
+	return out.good();
+}
+
+/**
+ * Saves a segmentation to a binary graph file.
+ *
+ * @param segmentation segmentation to save.
+ * @param filename name of the file to write.
+ * @return true iff the file was successfully written.
+ */
+bool saveSegmentation(DisjointSetForest &segmentation, const string &filename);
+
+/**
+ * Read only memory mapping of a graph file. Edges, labels and segmentation
+ * arrays are accessed in place in the mapped memory, which stays valid as
+ * long as the file is open. The operating system shares the pages between
+ * all processes mapping the same file.
+ */
+class MappedGraphFile {
+private:
+	boost::interprocess::file_mapping file;
+	boost::interprocess::mapped_region region;
+	const GraphFileHeader *header;
+
+	// the mapping owns the file handle, so it cannot be copied.
+	MappedGraphFile(const MappedGraphFile &mapped);
+	MappedGraphFile &operator=(const MappedGraphFile &mapped);
+
+	const char *data() const;
+
+public:
+	MappedGraphFile();
+
+	/**
+	 * Maps a graph file into memory, checking its header and contents:
+	 * array sizes, edge endpoints and segmentation roots. This reads the
+	 * arrays once, so the graph or segmentation built from an open file
+	 * is always valid. Closes any previously open file.
+	 *
+	 * @param filename name of the file to map.
+	 * @return true iff the file could be mapped, has a valid header of the
+	 * current version and consistent contents. Callers typically rebuild
+	 * the graph from the image otherwise.
+	 */
+	bool open(const string &filename);
+
+	/**
+	 * Unmaps the current file. Pointers previously returned become invalid.
+	 */
+	void close();
+
+	bool isOpen() const;
+
+	GraphFileKind getKind() const;
+
+	/**
+	 * Number of vertices of the graph, or number of elements of the segmentation.
+	 */
+	int numberOfVertices() const;
+
+	/**
+	 * Number of edges of the graph, or number of components of the segmentation.
+	 */
+	int numberOfEdges() const;
+
+	/**
+	 * Returns the edge list of a mapped graph.
+	 */
+	const Edge *getEdges() const;
+
+	/**
+	 * Returns the vertex labels of a mapped labeled graph. The label type
+	 * must be the one the graph was saved with.
+	 */
+	template < typename T >
+	const T *getLabels() const {
+		assert(this->getKind() == LABELED_GRAPH_FILE && this->header->labelSize == sizeof(T));
+
+		return (const T*)(this->data() + graphFileLabelsOffset(this->numberOfEdges()));
+	}
+
+	/**
+	 * Returns the root of each element of a mapped segmentation.
+	 */
+	const int *getRoots() const;
+
+	/**
+	 * Returns the set size of each root of a mapped segmentation, entries for
+	 * non-root elements are unspecified.
+	 */
+	const int *getComponentSizes() const;
+
+	/**
+	 * Builds a weighted graph from the mapped edge list, without any parsing.
+	 *
+	 * @param maxDegree optional upper bound on the degree of vertices.
+	 * @param arena optional arena for the adjacency lists of the graph.
+	 */
+	WeightedGraph toWeightedGraph(int maxDegree = -1, GraphArena *arena = NULL) const;
+
+	/**
+	 * Builds a labeled graph from the mapped edge list and labels.
+	 */
+	template < typename T >
+	LabeledGraph<T> toLabeledGraph(int maxDegree = -1) const {
+		const T *labels = this->getLabels<T>();
+		LabeledGraph<T> graph(this->numberOfVertices(), maxDegree, vector<T>(labels, labels + this->numberOfVertices()));
+		const Edge *edges = this->getEdges();
+
+		for (int i = 0; i < this->numberOfEdges(); i++) {
+			graph.addEdge(edges[i].source, edges[i].destination, edges[i].weight);
+		}
+
+		return graph;
+	}
+
+	/**
+	 * Builds a segmentation from the mapped arrays in O(n) time.
+	 */
+	DisjointSetForest toSegmentation() const;
+};
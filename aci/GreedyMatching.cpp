@@ -0,0 +1,144 @@
+#include "GreedyMatching.h"
+
+#include <queue>
+#include <algorithm>
+
+/**
+ * Orders the candidates of a row, the most similar one first, breaking ties
+ * by column index.
+ */
+class RowCandidateCompare {
+private:
+	const CandidatePairs *candidates;
+
+public:
+	RowCandidateCompare(const CandidatePairs *candidates)
+		: candidates(candidates)
+	{
+
+	}
+
+	bool operator()(int k1, int k2) const {
+		double s1 = this->candidates->similarities[k1];
+		double s2 = this->candidates->similarities[k2];
+
+		return s1 < s2 || (s1 == s2 && this->candidates->cols[k1] > this->candidates->cols[k2]);
+	}
+};
+
+/**
+ * Best remaining candidate pair of a row.
+ */
+struct RowCandidate {
+	double similarity;
+	int row;
+	int col;
+};
+
+class RowCandidateOrder {
+public:
+	bool operator()(const RowCandidate &c1, const RowCandidate &c2) const {
+		return c1.similarity < c2.similarity || (c1.similarity == c2.similarity && c1.row > c2.row);
+	}
+};
+
+void allCandidatePairs(const MatrixXd &similarities, int start, CandidatePairs &candidates) {
+	int nbRows = max((int)similarities.rows() - start, 0);
+	int nbCols = max((int)similarities.cols() - start, 0);
+
+	candidates.offsets.resize(nbRows + 1);
+	candidates.cols.resize(nbRows * nbCols);
+	candidates.similarities.resize(nbRows * nbCols);
+
+	for (int i = 0; i < nbRows; i++) {
+		candidates.offsets[i] = i * nbCols;
+
+		for (int j = 0; j < nbCols; j++) {
+			candidates.cols[i * nbCols + j] = start + j;
+			candidates.similarities[i * nbCols + j] = similarities(start + i, start + j);
+		}
+	}
+	candidates.offsets[nbRows] = nbRows * nbCols;
+}
+
+
+void greedyMatching(CandidatePairs &candidates, int start, int rows, int cols, double defaultSimilarity, vector<std::tuple<int, int, double> > &matching) {
+	matching.clear();
+
+	if (rows <= start || cols <= start) {
+		return;
+	}
+	assert((int)candidates.offsets.size() == rows - start + 1);
+	int nbMatches = min(rows, cols) - start;
+	matching.reserve(nbMatches);
+
+	RowCandidateCompare compare(&candidates);
+	// heaps of candidate indexes of each row, ending at heapEnds.
+	vector<int> heaps(candidates.cols.size());
+	vector<int> heapEnds(rows - start);
+	priority_queue<RowCandidate, vector<RowCandidate>, RowCandidateOrder> bestCandidates;
+
+	for (int i = start; i < rows; i++) {
+		int rowBegin = candidates.offsets[i - start];
+		int rowEnd = candidates.offsets[i - start + 1];
+
+		for (int k = rowBegin; k < rowEnd; k++) {
+			heaps[k] = k;
+		}
+		heapEnds[i - start] = rowEnd;
+
+		if (rowBegin < rowEnd) {
+			make_heap(heaps.begin() + rowBegin, heaps.begin() + rowEnd, compare);
+
+			RowCandidate best;
+			best.similarity = candidates.similarities[heaps[rowBegin]];
+			best.row = i;
+			best.col = candidates.cols[heaps[rowBegin]];
+			bestCandidates.push(best);
+		}
+	}
+
+	vector<bool> rowAdded(rows, false);
+	vector<bool> colAdded(cols, false);
+
+	while (!bestCandidates.empty() && (int)matching.size() < nbMatches) {
+		RowCandidate best = bestCandidates.top();
+		bestCandidates.pop();
+
+		if (!colAdded[best.col]) {
+			matching.push_back(std::tuple<int,int,double>(best.row, best.col, best.similarity));
+			rowAdded[best.row] = true;
+			colAdded[best.col] = true;
+			continue;
+		}
+
+		// the column has been matched, so the row yields its next best
+		// free candidate, if any.
+		int rowBegin = candidates.offsets[best.row - start];
+		int &heapEnd = heapEnds[best.row - start];
+
+		while (heapEnd > rowBegin && colAdded[candidates.cols[heaps[rowBegin]]]) {
+			pop_heap(heaps.begin() + rowBegin, heaps.begin() + heapEnd, compare);
+			heapEnd--;
+		}
+
+		if (heapEnd > rowBegin) {
+			best.similarity = candidates.similarities[heaps[rowBegin]];
+			best.col = candidates.cols[heaps[rowBegin]];
+			bestCandidates.push(best);
+		}
+	}
+
+	int j = start;
+
+	for (int i = start; i < rows && (int)matching.size() < nbMatches; i++) {
+		if (rowAdded[i]) {
+			continue;
+		}
+		while (colAdded[j]) {
+			j++;
+		}
+		matching.push_back(std::tuple<int,int,double>(i, j, defaultSimilarity));
+		colAdded[j] = true;
+	}
+}
@@ -0,0 +1,50 @@
+/** @file */
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <Eigen/Dense>
+
+using namespace std;
+using namespace Eigen;
+
+/**
+ * Candidate pairs of segments from 2 images with their similarity, the
+ * candidates of row i being in [offsets[i - start]; offsets[i - start + 1]).
+ */
+struct CandidatePairs {
+	vector<int> offsets;
+	vector<int> cols;
+	vector<double> similarities;
+};
+
+/**
+ * Lists all pairs of rows and columns from start of a similarity matrix as
+ * candidates.
+ */
+void allCandidatePairs(const MatrixXd &similarities, int start, CandidatePairs &candidates);
+
+/**
+ * Greedily matches rows and columns from the most to the least similar
+ * candidate pair whose row and column are both free, breaking ties by row
+ * then column index. Rather than sorting all pairs, each row keeps a heap
+ * of its candidates and a heap of rows yields their best candidate. A
+ * candidate whose column has been matched is only discarded when it
+ * reaches the top of its row, so the work beyond building the heaps in
+ * linear time is proportional to the number of discarded candidates.
+ *
+ * Rows and columns left without a free candidate are then matched in
+ * increasing index order with a default similarity, which gives the same
+ * matching as if all other pairs were candidates of that similarity, as
+ * long as it is lower than the similarity of all candidates.
+ *
+ * @param candidates candidate pairs with their similarity, the order of
+ * the candidates of a row being changed.
+ * @param start index of the first row and column to match.
+ * @param rows number of rows.
+ * @param cols number of columns.
+ * @param defaultSimilarity similarity of pairs which are not candidates.
+ * @param matching output (row, column, similarity) matched pairs, by
+ * decreasing similarity.
+ */
+void greedyMatching(CandidatePairs &candidates, int start, int rows, int cols, double defaultSimilarity, vector<std::tuple<int, int, double> > &matching);
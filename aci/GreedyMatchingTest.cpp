@@ -0,0 +1,193 @@
+#include "GreedyMatchingTest.h"
+
+class MatchingPairOrder {
+public:
+	bool operator()(const std::tuple<int,int,double> &p1, const std::tuple<int,int,double> &p2) const {
+		return get<2>(p1) > get<2>(p2);
+	}
+};
+
+/**
+ * Reference greedy matching, which stably sorts all pairs of a similarity
+ * matrix from start in row major order by decreasing similarity, then adds
+ * each pair whose row and column are both free.
+ */
+static void sortedGreedyMatching(const MatrixXd &similarities, int start, vector<std::tuple<int,int,double> > &matching) {
+	vector<std::tuple<int,int,double> > pairs;
+	vector<bool> rowAdded(similarities.rows(), false);
+	vector<bool> colAdded(similarities.cols(), false);
+
+	for (int i = start; i < similarities.rows(); i++) {
+		for (int j = start; j < similarities.cols(); j++) {
+			pairs.push_back(std::tuple<int,int,double>(i, j, similarities(i,j)));
+		}
+	}
+	stable_sort(pairs.begin(), pairs.end(), MatchingPairOrder());
+	matching.clear();
+
+	for (int k = 0; k < (int)pairs.size(); k++) {
+		int i = get<0>(pairs[k]);
+		int j = get<1>(pairs[k]);
+
+		if (!rowAdded[i] && !colAdded[j]) {
+			matching.push_back(pairs[k]);
+			rowAdded[i] = true;
+			colAdded[j] = true;
+		}
+	}
+}
+
+/**
+ * Random similarity matrix whose entries take few distinct values, so many
+ * pairs are tied.
+ */
+static MatrixXd randomSimilarities(int rows, int cols, int nbValues) {
+	MatrixXd similarities(rows, cols);
+
+	for (int i = 0; i < rows; i++) {
+		for (int j = 0; j < cols; j++) {
+			similarities(i,j) = (double)(rand() % nbValues) / nbValues;
+		}
+	}
+
+	return similarities;
+}
+
+/**
+ * Checks the matching of all pairs against the sorted greedy matching.
+ */
+static void testDenseGreedyMatching() {
+	for (int t = 0; t < 1000; t++) {
+		int rows = rand() % 30;
+		int cols = rand() % 30;
+		int start = rand() % 2;
+		MatrixXd similarities = randomSimilarities(rows, cols, 1 + rand() % 5);
+		CandidatePairs candidates;
+		vector<std::tuple<int,int,double> > expected;
+		vector<std::tuple<int,int,double> > actual;
+
+		sortedGreedyMatching(similarities, start, expected);
+		allCandidatePairs(similarities, start, candidates);
+		greedyMatching(candidates, start, rows, cols, 0, actual);
+
+		assert(actual == expected);
+	}
+}
+
+/**
+ * Checks the matching of random subsets of pairs, including rows without
+ * any candidate, against the sorted greedy matching of all pairs where the
+ * others are given the default similarity.
+ */
+static void testSparseGreedyMatching() {
+	double defaultSimilarity = -1;
+
+	for (int t = 0; t < 1000; t++) {
+		int rows = rand() % 30;
+		int cols = rand() % 30;
+		int start = rand() % 2;
+		MatrixXd similarities = randomSimilarities(rows, cols, 1 + rand() % 5);
+		MatrixXd filled = MatrixXd::Constant(rows, cols, defaultSimilarity);
+		int density = rand() % 4;
+		CandidatePairs candidates;
+
+		candidates.offsets.push_back(0);
+
+		for (int i = start; i < rows; i++) {
+			// leaves some rows without candidates.
+			if (rand() % 4 != 0) {
+				for (int j = start; j < cols; j++) {
+					if (rand() % 4 < density) {
+						candidates.cols.push_back(j);
+						candidates.similarities.push_back(similarities(i,j));
+						filled(i,j) = similarities(i,j);
+					}
+				}
+			}
+			candidates.offsets.push_back((int)candidates.cols.size());
+		}
+
+		vector<std::tuple<int,int,double> > expected;
+		vector<std::tuple<int,int,double> > actual;
+
+		sortedGreedyMatching(filled, start, expected);
+		greedyMatching(candidates, start, rows, cols, defaultSimilarity, actual);
+
+		assert(actual == expected);
+	}
+}
+
+/**
+ * Random gravity centers and areas of segments, see SegmentIndex.
+ */
+static void randomSegments(int nbSegments, MatrixXf &centers, MatrixXf &areas) {
+	centers = MatrixXf::Random(2, nbSegments) * 0.6f + MatrixXf::Constant(2, nbSegments, 0.5f);
+	areas = MatrixXf(1, nbSegments);
+
+	for (int s = 0; s < nbSegments; s++) {
+		areas(0,s) = (float)(1 + rand() % 5000);
+	}
+}
+
+/**
+ * Checks the matching of the candidate pairs of a segment index, as done by
+ * the classifier, against the sorted greedy matching of all pairs where the
+ * unscored ones are given a lower bound of the similarity. Covers queries
+ * outside of the indexed log-area range, ignored first segments and samples
+ * without segments.
+ */
+static void testIndexedGreedyMatching() {
+	double lowerBound = -1;
+
+	for (int t = 0; t < 1000; t++) {
+		int rows = rand() % 30;
+		int cols = rand() % 30;
+		int start = rand() % 2;
+		MatrixXd similarities = randomSimilarities(rows, cols, 1 + rand() % 5);
+		MatrixXd filled = MatrixXd::Constant(rows, cols, lowerBound);
+		MatrixXf lCenters, lAreas, sCenters, sAreas;
+
+		randomSegments(rows, lCenters, lAreas);
+		randomSegments(cols, sCenters, sAreas);
+
+		// queries much smaller or larger than every indexed segment.
+		for (int i = 0; i < rows; i++) {
+			if (rand() % 5 == 0) {
+				lAreas(0,i) = rand() % 2 == 0 ? 0.f : 1e7f;
+			}
+		}
+
+		SegmentIndex index(sCenters, sAreas, start, 0.05f + 0.5f * (float)rand() / (float)RAND_MAX, 0.1f + 2.f * (float)rand() / (float)RAND_MAX);
+		CandidatePairs candidates;
+		vector<int> rowCandidates;
+
+		candidates.offsets.push_back(0);
+
+		for (int i = start; i < rows; i++) {
+			index.candidates(lCenters(0,i), lCenters(1,i), lAreas(0,i), rowCandidates);
+
+			for (int c = 0; c < (int)rowCandidates.size(); c++) {
+				int j = rowCandidates[c];
+
+				candidates.cols.push_back(j);
+				candidates.similarities.push_back(similarities(i,j));
+				filled(i,j) = similarities(i,j);
+			}
+			candidates.offsets.push_back((int)candidates.cols.size());
+		}
+
+		vector<std::tuple<int,int,double> > expected;
+		vector<std::tuple<int,int,double> > actual;
+
+		sortedGreedyMatching(filled, start, expected);
+		greedyMatching(candidates, start, rows, cols, lowerBound, actual);
+
+		assert(actual == expected);
+	}
+}
+
+void testGreedyMatching() {
+	testDenseGreedyMatching();
+	testSparseGreedyMatching();
+	testIndexedGreedyMatching();
+}
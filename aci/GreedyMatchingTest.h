@@ -0,0 +1,12 @@
+/** @file */
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+
+#include "GreedyMatching.h"
+#include "SegmentIndex.h"
+
+using namespace std;
+
+void testGreedyMatching();
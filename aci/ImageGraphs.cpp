@@ -3,9 +3,9 @@
 #define MIN_EDGE_WEIGHT 0
 #define HUE_FACTOR (1./500.)
 
-WeightedGraph gridGraph(const Mat_<Vec3f> &image, ConnectivityType connectivity, Mat_<float> mask, double (*simFunc)(const Mat&, const Mat&), bool bidirectional) {
+WeightedGraph gridGraph(const Mat_<Vec3f> &image, ConnectivityType connectivity, Mat_<float> mask, double (*simFunc)(const Mat&, const Mat&), bool bidirectional, GraphArena *arena) {
 	assert(image.rows == mask.rows && image.cols == mask.cols);
-	WeightedGraph grid(image.cols*image.rows, 4);
+	WeightedGraph grid(image.cols*image.rows, 4, arena);
 	// indicates neigbor positions depending on connectivity
 	int numberOfNeighbors[2] = {2, 4};
 	int colOffsets[2][4] = {{0, 1, 0, 0}, {-1, 0, 1, 1}};
@@ -26,8 +26,10 @@ using namespace std;
  * @param bidirectional set to true so that edges are repeated in both directions in the
  * adjacency list representation. This is useful for more efficient listing of vertices
  * neighbors, but consumes more space.
+ * @param arena optional arena for the adjacency lists of the graph, see
+ * WeightedGraph::WeightedGraph(int,int,GraphArena*).
  */
-WeightedGraph gridGraph(const Mat_<Vec3f> &image, ConnectivityType connectivity, Mat_<float> mask, double (*simFunc)(const Mat&, const Mat&), bool bidirectional = false);
+WeightedGraph gridGraph(const Mat_<Vec3f> &image, ConnectivityType connectivity, Mat_<float> mask, double (*simFunc)(const Mat&, const Mat&), bool bidirectional = false, GraphArena *arena = NULL);
 
 /**
  * Returns a graph where vertices are pixels in the image, and every vertex has an edge
@@ -1,24 +1,29 @@
 #include "MatchingSegmentsClassifier.h"
 
-#define NB_FEATURES 3
+#include "GreedyMatching.h"
+
 #define COLOR_SIGMA 20
 #define AREA_SIGMA 500
 #define CENTERS_SIGMA 0.3
+#define VALIDATE_SIMILARITY_TABLE false
 
-static bool compareSim(const std::tuple<int, int, double> &s1, const std::tuple<int, int, double> &s2) {
-	return get<2>(s1) > get<2>(s2);
-}
+/**
+ * Indexes of the features of the classifier, which are the inputs of its
+ * similarity rules and of the similarity lookup table in this order.
+ */
+enum MatchingFeature { COLOR_FEATURE = 0, AREA_FEATURE = 1, POSITION_FEATURE = 2, NB_FEATURES = 3 };
 
-MatchingSegmentClassifier::MatchingSegmentClassifier(bool ignoreFirst) 
-	: ignoreFirst(ignoreFirst), features(NB_FEATURES)
+MatchingSegmentClassifier::MatchingSegmentClassifier(bool ignoreFirst, int similarityTableResolution, float candidatePositionRadius, float candidateLogAreaRadius) 
+	: ignoreFirst(ignoreFirst), features(NB_FEATURES), candidatePositionRadius(candidatePositionRadius), candidateLogAreaRadius(candidateLogAreaRadius)
 {
+	assert(candidatePositionRadius <= 0 || candidateLogAreaRadius > 0);
 	// set up the fuzzy control system for segment similarity
 	// a bit elaborate to get around the awkward API for fuzzylite.
 	this->similarity = new fl::Engine("segment-similarity");
 
 	//cout<<"preparing color input variable"<<endl;
 	// average color input variable
-	get<0>(features[0]) = averageColorLabeling;
+	get<0>(features[COLOR_FEATURE]) = new FixedSegmentFeature<3>(averageColorFeature);
 	fl::InputVariable *color = new fl::InputVariable();
 	color->setName("Color");
 	color->setRange(0,1);
@@ -26,11 +31,11 @@ MatchingSegmentClassifier::MatchingSegmentClassifier(bool ignoreFirst)
 	color->addTerm(new fl::Triangle("MEDIUM", 0, 0.5, 1));
 	color->addTerm(new fl::Triangle("HIGH", 0.5, 1, 1));
 	this->similarity->addInputVariable(color);
-	get<1>(features[0]) = color;
+	get<1>(features[COLOR_FEATURE]) = color;
 
 	//cout<<"preparing area input variable"<<endl;
 	// segment area input variable
-	get<0>(features[1]) = segmentAreaLabeling;
+	get<0>(features[AREA_FEATURE]) = new FixedSegmentFeature<1>(segmentAreaFeature);
 	fl::InputVariable *area = new fl::InputVariable();
 	area->setName("Area");
 	area->setRange(0,1);
@@ -38,11 +43,11 @@ MatchingSegmentClassifier::MatchingSegmentClassifier(bool ignoreFirst)
 	area->addTerm(new fl::Triangle("MEDIUM", 0, 0.5, 1));
 	area->addTerm(new fl::Triangle("HIGH", 0.5, 1, 1));
 	this->similarity->addInputVariable(area);
-	get<1>(features[1]) = area;
+	get<1>(features[AREA_FEATURE]) = area;
 
 	//cout<<"preparing position input variable"<<endl;
 	// gravity center input variable
-	get<0>(features[2]) = gravityCenterLabeling;
+	get<0>(features[POSITION_FEATURE]) = new FixedSegmentFeature<2>(gravityCenterFeature);
 	fl::InputVariable *position = new fl::InputVariable();
 	position->setName("Position");
 	position->setRange(0,1);
@@ -50,7 +55,7 @@ MatchingSegmentClassifier::MatchingSegmentClassifier(bool ignoreFirst)
 	position->addTerm(new fl::Triangle("MEDIUM", 0, 0.5, 1));
 	position->addTerm(new fl::Triangle("HIGH", 0.5, 1, 1));
 	this->similarity->addInputVariable(position);
-	get<1>(features[2]) = position;
+	get<1>(features[POSITION_FEATURE]) = position;
 
 	//cout<<"preparing similarity output variable"<<endl;
 	// segment similarity output variable
@@ -91,109 +96,218 @@ MatchingSegmentClassifier::MatchingSegmentClassifier(bool ignoreFirst)
 	//cout<<"configuring"<<endl;
 	this->similarity->configure("Minimum", "Maximum", "AlgebraicProduct", "AlgebraicSum", "Centroid");
 
+	// compiles the rule base into a lookup table, as inference is by far
+	// the most expensive step of matching.
+	if (similarityTableResolution > 0) {
+		this->similarityTable.compile(this->similarity, this->getInputVariables(), this->similarityOutput, similarityTableResolution);
+
+		if (VALIDATE_SIMILARITY_TABLE) {
+			cout<<"similarity table maximum error = "<<this->similarityTableError()<<endl;
+		}
+	}
+
+	// the similarity of unscored pairs must not exceed the one of any pair.
+	if (this->similarityTable.isCompiled()) {
+		this->similarityLowerBound = this->similarityTable.minimum();
+	} else {
+		this->similarityLowerBound = this->similarityOutput->getMinimum();
+	}
+
 	//cout<<"successfullty initialized engine"<<endl;
 }
 
+vector<fl::InputVariable*> MatchingSegmentClassifier::getInputVariables() const {
+	vector<fl::InputVariable*> inputs(this->features.size());
+
+	for (int k = 0; k < (int)this->features.size(); k++) {
+		inputs[k] = get<1>(this->features[k]);
+	}
+
+	return inputs;
+}
+
+double MatchingSegmentClassifier::engineSimilarity(const vector<double> &featureSimilarities) {
+	for (int k = 0; k < (int)this->features.size(); k++) {
+		get<1>(this->features[k])->setInput(featureSimilarities[k]);
+	}
+
+	this->similarity->process();
+
+	return this->similarityOutput->defuzzify();
+}
+
+double MatchingSegmentClassifier::pairSimilarity(const vector<double> &featureSimilarities, double &maxTableError) {
+	if (!this->similarityTable.isCompiled()) {
+		return this->engineSimilarity(featureSimilarities);
+	}
+
+	double tableSimilarity = this->similarityTable.evaluate(
+		(float)featureSimilarities[COLOR_FEATURE],
+		(float)featureSimilarities[AREA_FEATURE],
+		(float)featureSimilarities[POSITION_FEATURE]);
+
+	if (VALIDATE_SIMILARITY_TABLE) {
+		maxTableError = max(maxTableError, fabs(this->engineSimilarity(featureSimilarities) - tableSimilarity));
+	}
+
+	return tableSimilarity;
+}
+
+const SegmentIndex *MatchingSegmentClassifier::candidateIndex(int trainingIndex) const {
+	return this->trainingIndexes[trainingIndex].isBuilt() ? &this->trainingIndexes[trainingIndex] : NULL;
+}
+
+double MatchingSegmentClassifier::similarityTableError(int randomSamples) {
+	return this->similarityTable.maxError(this->similarity, this->getInputVariables(), this->similarityOutput, randomSamples);
+}
+
 MatchingSegmentClassifier::~MatchingSegmentClassifier() {
 	delete similarity;
+
+	for (int i = 0; i < (int)this->features.size(); i++) {
+		delete get<0>(this->features[i]);
+	}
 }
 
-void MatchingSegmentClassifier::computeSegmentLabels(DisjointSetForest &seg, const Mat_<Vec3f> &image, const Mat_<float> &mask, vector<vector<VectorXd> > &segmentLabels) {
-	segmentLabels.clear();
-	segmentLabels.reserve(this->features.size());
+void MatchingSegmentClassifier::computeSegmentLabels(DisjointSetForest &seg, const Mat_<Vec3f> &image, const Mat_<float> &mask, SegmentLabels &segmentLabels) {
+	// features are colors, areas and positions, so hues are not gathered.
+	SegmentStatistics statistics(seg, image, mask);
+
+	segmentLabels.blocks.resize(this->features.size());
+	segmentLabels.doubleBlocks.resize(this->features.size());
+	segmentLabels.squaredNorms.resize(this->features.size());
 
 	for (int i = 0; i < (int)features.size(); i++) {
-		segmentLabels.push_back(get<0>(features[i])(seg, image, mask));
+		get<0>(features[i])->compute(statistics, segmentLabels.blocks[i]);
+		segmentLabels.doubleBlocks[i] = segmentLabels.blocks[i].cast<double>();
+		get<0>(features[i])->squaredNorms(segmentLabels.doubleBlocks[i], segmentLabels.squaredNorms[i]);
 	}
 }
 
-void MatchingSegmentClassifier::mostSimilarSegmentLabels(const vector<vector<VectorXd> > &lLabels, const vector<vector<VectorXd> > &sLabels, vector<std::tuple<int, int, double> > &matching, int lNbSeg, int sNbSeg) {
+void MatchingSegmentClassifier::mostSimilarSegmentLabels(const SegmentLabels &lLabels, const SegmentLabels &sLabels, vector<std::tuple<int, int, double> > &matching, int lNbSeg, int sNbSeg, const SegmentIndex *sIndex) {
 	int startSeg = ignoreFirst ? 1 : 0;
 
-	// evaluate similarity for all pairs
-	vector<std::tuple<int, int, double> > allPairsSimilarity;
-	allPairsSimilarity.reserve((lNbSeg - startSeg) * (sNbSeg - startSeg));
-
 	//cout<<"computing euclid distances"<<endl;
-	vector<MatrixXd> euclidDistances(this->features.size());
+	vector<MatrixXd> squaredDistances(this->features.size());
 
-	// first evaluate euclidean distances for automatic sigma determination
+	// first evaluate squared euclidean distances for automatic sigma
+	// determination, for all pairs at once.
 	for (int k = 0; k < (int)this->features.size(); k++) {
-		euclidDistances[k] = MatrixXd::Zero(lNbSeg, sNbSeg);
-		for (int i = startSeg; i < lNbSeg; i++) {
-			for (int j = startSeg; j < sNbSeg; j++) {
-				euclidDistances[k](i,j) = (lLabels[k][i] - sLabels[k][j]).norm();
-			}
-		}
+		assert(lLabels.blocks[k].cols() == lNbSeg && sLabels.blocks[k].cols() == sNbSeg);
+		get<0>(this->features[k])->squaredDistances(
+			lLabels.doubleBlocks[k], lLabels.squaredNorms[k], 
+			sLabels.doubleBlocks[k], sLabels.squaredNorms[k], 
+			startSeg, squaredDistances[k]);
 	}
 
 	//cout<<"computing variance for each feature"<<endl;
-	// evaluate sigma^2 as the variance of the euclid distances for the feature
+	// evaluate sigma^2 as the variance of the euclid distances for the
+	// feature. The mean is taken over the whole matrix, including the 0
+	// entries of ignored segments.
 	vector<double> variances(this->features.size(), 0);
+	int nbPairs = (lNbSeg - startSeg) * (sNbSeg - startSeg);
 
 	for (int k = 0; k < (int)this->features.size(); k++) {
-		double mean = euclidDistances[k].mean();
+		double mean = squaredDistances[k].cwiseSqrt().mean();
 
-		for (int i = startSeg; i < lNbSeg; i++) {
-			for (int j = startSeg; j < sNbSeg; j++) {
-				variances[k] += pow(euclidDistances[k](i,j), 2);
-			}
+		variances[k] = squaredDistances[k].sum() / (double)nbPairs - mean * mean;
+	}
+
+	CandidatePairs candidates;
+	double defaultSimilarity = 0;
+	double maxTableError = 0;
+
+	if (sIndex == NULL) {
+		//cout<<"computing similarity"<<endl;
+		// evaluate similarity for each features individually
+		vector<MatrixXd> featureSimilarities(this->features.size());
+
+		for (int k = 0; k < (int)this->features.size(); k++) {
+			featureSimilarities[k] = (squaredDistances[k].array() * (-1. / variances[k])).exp().matrix();
 		}
 
-		variances[k] = variances[k] / (double)((lNbSeg - startSeg) * (sNbSeg - startSeg));
-		variances[k] -= pow(mean, 2);
-	}
+		// combine them for all pairs at once through the lookup table, or
+		// run the fuzzy similarity engine on each pair.
+		MatrixXd resultSimilarities;
 
-	//cout<<"computing similarity"<<endl;
+		if (!this->similarityTable.isCompiled()) {
+			resultSimilarities = MatrixXd::Zero(lNbSeg, sNbSeg);
+			vector<double> pairFeatureSimilarities(this->features.size());
 
-	for (int i = startSeg; i < lNbSeg; i++) {
-		for (int j = startSeg; j < sNbSeg; j++) {
-			// evaluate similarity for each features individually
-			for (int k = 0; k < (int)features.size(); k++) {
-				fl::scalar sim = exp(- pow(euclidDistances[k](i,j), 2) / variances[k]);
-				//cout<<"feature "<<k<<" has similarity "<<sim<<endl<<get<1>(this->features[k])->fuzzify(sim)<<endl;
-				get<1>(this->features[k])->setInput(sim);
-			}
+			for (int i = startSeg; i < lNbSeg; i++) {
+				for (int j = startSeg; j < sNbSeg; j++) {
+					for (int k = 0; k < (int)this->features.size(); k++) {
+						pairFeatureSimilarities[k] = featureSimilarities[k](i,j);
+					}
 
-			// run fuzzy similarity engine
-			this->similarity->process();
+					resultSimilarities(i,j) = this->engineSimilarity(pairFeatureSimilarities);
+				}
+			}
+		} else {
+			this->similarityTable.evaluate(featureSimilarities[COLOR_FEATURE], featureSimilarities[AREA_FEATURE], featureSimilarities[POSITION_FEATURE], resultSimilarities);
 
-			fl::scalar resultSimilarity = this->similarityOutput->defuzzify();
+			if (VALIDATE_SIMILARITY_TABLE) {
+				vector<double> pairFeatureSimilarities(this->features.size());
 
-			//cout<<"similarity = "<<this->similarityOutput->fuzzify(resultSimilarity)<<endl;
+				for (int i = startSeg; i < lNbSeg; i++) {
+					for (int j = startSeg; j < sNbSeg; j++) {
+						for (int k = 0; k < (int)this->features.size(); k++) {
+							pairFeatureSimilarities[k] = featureSimilarities[k](i,j);
+						}
 
-			allPairsSimilarity.push_back(std::tuple<int,int,double>(i,j,resultSimilarity));
+						maxTableError = max(maxTableError, fabs(this->engineSimilarity(pairFeatureSimilarities) - resultSimilarities(i,j)));
+					}
+				}
+			}
 		}
-	}
 
-	// sort the pairs by similarity, and add them from most to least similar
-	matching.clear();
-	matching.reserve((lNbSeg - startSeg) * (sNbSeg - startSeg));
+		allCandidatePairs(resultSimilarities, startSeg, candidates);
+	} else {
+		// only score the pairs of segments with close gravity centers and
+		// areas, as the others are too dissimilar to be matched early.
+		const MatrixXf &lCenters = lLabels.blocks[POSITION_FEATURE];
+		const MatrixXf &lAreas = lLabels.blocks[AREA_FEATURE];
+		vector<int> rowCandidates;
+		vector<double> featureSimilarities(this->features.size());
+
+		candidates.offsets.reserve(lNbSeg - startSeg + 1);
+		candidates.offsets.push_back(0);
 
-	sort(allPairsSimilarity.begin(), allPairsSimilarity.end(), compareSim);
+		for (int i = startSeg; i < lNbSeg; i++) {
+			sIndex->candidates(lCenters(0,i), lCenters(1,i), lAreas(0,i), rowCandidates);
 
-	vector<bool> lAdded(lNbSeg, false);
-	vector<bool> sAdded(sNbSeg, false);
+			for (int c = 0; c < (int)rowCandidates.size(); c++) {
+				int j = rowCandidates[c];
 
-	for (int i = 0; i < (int)allPairsSimilarity.size(); i++) {
-		std::tuple<int,int,double> edge = allPairsSimilarity[i];
+				for (int k = 0; k < (int)this->features.size(); k++) {
+					featureSimilarities[k] = exp(-squaredDistances[k](i,j) / variances[k]);
+				}
 
-		if (!lAdded[get<0>(edge)] && !sAdded[get<1>(edge)]) {
-			matching.push_back(edge);
-			lAdded[get<0>(edge)] = true;
-			sAdded[get<1>(edge)] = true;
+				candidates.cols.push_back(j);
+				candidates.similarities.push_back(this->pairSimilarity(featureSimilarities, maxTableError));
+			}
+			candidates.offsets.push_back((int)candidates.cols.size());
 		}
+
+		defaultSimilarity = this->similarityLowerBound;
 	}
+
+	if (VALIDATE_SIMILARITY_TABLE && this->similarityTable.isCompiled()) {
+		cout<<"similarity table maximum error on "<<candidates.cols.size()<<" pairs = "<<maxTableError<<endl;
+	}
+
+	// add pairs from most to least similar
+	greedyMatching(candidates, startSeg, lNbSeg, sNbSeg, defaultSimilarity, matching);
 }
 
 double MatchingSegmentClassifier::computeSimilarity(DisjointSetForest &testSeg, const Mat_<Vec3f> &testImage, const Mat_<float> &testMask, const vector<int> &compSizes, int trainingIndex) {
-	vector<vector<VectorXd> > segmentLabels;
+	SegmentLabels segmentLabels;
 
 	this->computeSegmentLabels(testSeg, testImage, testMask, segmentLabels);
 
 	vector<std::tuple<int,int,double> > matching;
 
-	this->mostSimilarSegmentLabels(segmentLabels, get<0>(this->trainingLabels[trainingIndex]), matching, testSeg.getNumberOfComponents(), get<0>(this->trainingLabels[trainingIndex])[0].size());
+	this->mostSimilarSegmentLabels(segmentLabels, get<0>(this->trainingLabels[trainingIndex]), matching, testSeg.getNumberOfComponents(), get<0>(this->trainingLabels[trainingIndex]).numberOfSegments(), this->candidateIndex(trainingIndex));
 
 	double similarity = 0;
 
@@ -211,7 +325,7 @@ vector<std::tuple<int, int, double> > MatchingSegmentClassifier::mostSimilarSegm
 	DisjointSetForest &sSeg, const Mat_<Vec3f> &sImage, const Mat_<float> &sMask) {
 	
 	// evaluate labeling functions on both segmentations
-	vector<vector<VectorXd> > lLabels, sLabels;
+	SegmentLabels lLabels, sLabels;
 
 	this->computeSegmentLabels(lSeg, lImage, lMask, lLabels);
 	this->computeSegmentLabels(sSeg, sImage, sMask, sLabels);
@@ -226,6 +340,9 @@ vector<std::tuple<int, int, double> > MatchingSegmentClassifier::mostSimilarSegm
 void MatchingSegmentClassifier::train(vector<std::tuple<DisjointSetForest, Mat_<Vec3f>, Mat_<float>, int> > &trainingSet) {
 	this->trainingLabels.clear();
 	this->trainingLabels.reserve(trainingSet.size());
+	this->trainingIndexes.clear();
+	this->trainingIndexes.reserve(trainingSet.size());
+	int startSeg = this->ignoreFirst ? 1 : 0;
 	typedef std::tuple<DisjointSetForest, Mat_<Vec3f>, Mat_<float> > Sample;
 	vector<Sample> samples;
 	samples.reserve(trainingSet.size());
@@ -234,17 +351,28 @@ void MatchingSegmentClassifier::train(vector<std::tuple<DisjointSetForest, Mat_<
 	this->maxClassLabel = 0;
 
 	for (int i = 0; i < (int)trainingSet.size(); i++) {
-		vector<vector<VectorXd> > segmentLabels;
+		SegmentLabels segmentLabels;
 		this->computeSegmentLabels(get<0>(trainingSet[i]), get<1>(trainingSet[i]), get<2>(trainingSet[i]), segmentLabels);
 
 		vector<int> compSizes(get<0>(trainingSet[i]).getNumberOfComponents(), 0);
-		map<int,int> rootIndexes = get<0>(trainingSet[i]).getRootIndexes();
+		const vector<int> &segmentRoots = get<0>(trainingSet[i]).getSegmentRoots();
 
-		for (map<int,int>::iterator it = rootIndexes.begin(); it != rootIndexes.end(); it++) {
-			compSizes[(*it).second] = get<0>(trainingSet[i]).getComponentSize((*it).first);
+		for (int j = 0; j < (int)segmentRoots.size(); j++) {
+			compSizes[j] = get<0>(trainingSet[i]).getComponentSize(segmentRoots[j]);
 		}
 
-		this->trainingLabels.push_back(std::tuple<vector<vector<VectorXd> >, vector<int>, int>(segmentLabels, compSizes, get<3>(trainingSet[i])));
+		this->trainingLabels.push_back(std::tuple<SegmentLabels, vector<int>, int>(segmentLabels, compSizes, get<3>(trainingSet[i])));
+
+		if (this->candidatePositionRadius > 0) {
+			this->trainingIndexes.push_back(SegmentIndex(
+				segmentLabels.blocks[POSITION_FEATURE], 
+				segmentLabels.blocks[AREA_FEATURE], 
+				startSeg, 
+				this->candidatePositionRadius, 
+				this->candidateLogAreaRadius));
+		} else {
+			this->trainingIndexes.push_back(SegmentIndex());
+		}
 		this->maxClassLabel = max(this->maxClassLabel, get<3>(trainingSet[i]));
 		samples.push_back(Sample(get<0>(trainingSet[i]), get<1>(trainingSet[i]), get<2>(trainingSet[i])));
 		classLabels.push_back(get<3>(trainingSet[i]));
@@ -268,14 +396,14 @@ public:
 };
 
 int MatchingSegmentClassifier::predict(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask, int *nearestNeighborIndex, vector<std::tuple<int, int, double> > *bestMatching) {
-	vector<vector<VectorXd> > segmentLabels;
+	SegmentLabels segmentLabels;
 
 	this->computeSegmentLabels(segmentation, image, mask, segmentLabels);
-	map<int,int> rootIndexes = segmentation.getRootIndexes();
+	const vector<int> &segmentRoots = segmentation.getSegmentRoots();
 	vector<int> compSizes(segmentation.getNumberOfComponents(), 0);
 
-	for (map<int,int>::iterator it = rootIndexes.begin(); it != rootIndexes.end(); it++) {
-		compSizes[(*it).second] = segmentation.getComponentSize((*it).first);
+	for (int i = 0; i < (int)segmentRoots.size(); i++) {
+		compSizes[i] = segmentation.getComponentSize(segmentRoots[i]);
 	}
 
 	int nearestNeighbor = 0;
@@ -285,7 +413,7 @@ int MatchingSegmentClassifier::predict(DisjointSetForest &segmentation, const Ma
 	for (int i = 0; i < (int)this->trainingLabels.size(); i++) {
 		vector<std::tuple<int, int, double> > matching;
 
-		this->mostSimilarSegmentLabels(segmentLabels, get<0>(this->trainingLabels[i]), matching, segmentation.getNumberOfComponents(), get<0>(trainingLabels[i])[0].size());
+		this->mostSimilarSegmentLabels(segmentLabels, get<0>(this->trainingLabels[i]), matching, segmentation.getNumberOfComponents(), get<0>(trainingLabels[i]).numberOfSegments(), this->candidateIndex(i));
 
 		// compute weighted sum of matching similarities by size of test sample
 		// segment area.
@@ -325,7 +453,8 @@ void MatchingSegmentClassifier::similarityMatrix(MatrixXd &similarity) {
 				get<0>(this->trainingLabels[j]), 
 				matching, 
 				get<1>(this->trainingLabels[i]).size(), 
-				get<1>(this->trainingLabels[j]).size());
+				get<1>(this->trainingLabels[j]).size(),
+				this->candidateIndex(j));
 
 			for (int k = 0; k < matching.size(); k++) {
 				similarity(i,j) += (get<1>(this->trainingLabels[i])[get<0>(matching[k])] + get<1>(this->trainingLabels[j])[get<1>(matching[k])]) * get<2>(matching[k]);
@@ -6,6 +6,9 @@
 #include <fl/Headers.h>
 
 #include "SegmentAttributes.h"
+#include "SegmentFeatures.h"
+#include "FuzzyLookupTable.h"
+#include "SegmentIndex.h"
 #include "ModulatedSimilarityClassifier.h"
 
 using namespace cv;
@@ -14,24 +17,96 @@ using namespace std;
 
 class MatchingSegmentClassifier {
 private:
-	vector<std::tuple<SegmentLabeling, fl::InputVariable*> > features;
+	// features, owned by the classifier, with their fuzzy input variable.
+	vector<std::tuple<SegmentFeature*, fl::InputVariable*> > features;
 	fl::Engine *similarity;
 	fl::OutputVariable *similarityOutput;
+	// compiled similarity engine, empty if the engine is run for each pair.
+	FuzzyLookupTable similarityTable;
 	bool ignoreFirst;
 	// for each training sample, store its class label with
-	// the segment labels by featuress as well as segment size.
-	vector<std::tuple<vector<vector<VectorXd> >, vector<int>, int> > trainingLabels;
+	// the segment labels by features, with their squared norms, as well
+	// as segment sizes.
+	vector<std::tuple<SegmentLabels, vector<int>, int> > trainingLabels;
+	// radii of the candidate pairs of segments to score, 0 to score all
+	// pairs.
+	float candidatePositionRadius;
+	float candidateLogAreaRadius;
+	// similarity of the pairs which are not scored, lower than the
+	// similarity of any pair.
+	double similarityLowerBound;
+	// for each training sample, index of its segments by gravity center and
+	// area, empty if all pairs are scored.
+	vector<SegmentIndex> trainingIndexes;
 
-	void computeSegmentLabels(DisjointSetForest &seg, const Mat_<Vec3f> &image, const Mat_<float> &mask, vector<vector<VectorXd> > &segmentLabels);
+	/**
+	 * Labels the segments of an image with each feature, gathering the
+	 * statistics of its segments in a single pass over the image.
+	 */
+	void computeSegmentLabels(DisjointSetForest &seg, const Mat_<Vec3f> &image, const Mat_<float> &mask, SegmentLabels &segmentLabels);
+
+	/**
+	 * Matches the segments of 2 images from their labels.
+	 *
+	 * @param lLabels labels of the segments of the first image.
+	 * @param sLabels labels of the segments of the second image.
+	 * @param matching output (l, s, similarity) matched segments.
+	 * @param lNbSeg number of segments of the first image.
+	 * @param sNbSeg number of segments of the second image.
+	 * @param sIndex index of the segments of the second image, or NULL. If
+	 * given, only the pairs of segments it yields as candidates are scored,
+	 * and other pairs are given the similarity lower bound.
+	 */
+	void mostSimilarSegmentLabels(const SegmentLabels &lLabels, const SegmentLabels &sLabels, vector<std::tuple<int, int, double> > &matching, int lNbSeg, int sNbSeg, const SegmentIndex *sIndex = NULL);
+
+	/**
+	 * Combines the similarities of a pair of segments for each feature by
+	 * running the fuzzy similarity engine.
+	 */
+	double engineSimilarity(const vector<double> &featureSimilarities);
+
+	/**
+	 * Combines the similarities of a pair of segments for each feature,
+	 * through the lookup table if it is compiled.
+	 *
+	 * @param featureSimilarities similarity of the pair for each feature.
+	 * @param maxTableError maximum difference between the table and the
+	 * engine, updated iff the table is compiled and validated.
+	 * @return the similarity of the pair.
+	 */
+	double pairSimilarity(const vector<double> &featureSimilarities, double &maxTableError);
 
-	void mostSimilarSegmentLabels(const vector<vector<VectorXd> > &lLabels, const vector<vector<VectorXd> > &sLabels, vector<std::tuple<int, int, double> > &matching, int lNbSeg, int sNbSeg);
+	/**
+	 * Returns the segment index of a training sample, or NULL if all pairs
+	 * of segments are scored.
+	 */
+	const SegmentIndex *candidateIndex(int trainingIndex) const;
 
 	double computeSimilarity(DisjointSetForest &testSeg, const Mat_<Vec3f> &testImage, const Mat_<float> &testMask, const vector<int> &compSizes, int trainingIndex);
 
 	int maxClassLabel;
 
+	vector<fl::InputVariable*> getInputVariables() const;
+
 public:
-	MatchingSegmentClassifier(bool ignoreFirst = false);
+	/**
+	 * Initializes the classifier and its fuzzy segment similarity engine.
+	 *
+	 * @param ignoreFirst true iff the first segment of each segmentation must
+	 * be ignored.
+	 * @param similarityTableResolution number of samples along each input of
+	 * the lookup table the similarity engine is compiled into, or 0 to run
+	 * the engine for each pair of segments instead.
+	 * @param candidatePositionRadius if positive, only pairs of segments
+	 * whose gravity centers, relative to the image size, are closer than
+	 * this radius are scored when comparing to training samples. Others are
+	 * given a lower bound of the similarity, so their contribution to the
+	 * similarity of samples is underestimated rather than scored.
+	 * @param candidateLogAreaRadius maximum difference between the
+	 * logarithms of the areas of scored pairs of segments, used along with
+	 * candidatePositionRadius.
+	 */
+	MatchingSegmentClassifier(bool ignoreFirst = false, int similarityTableResolution = 33, float candidatePositionRadius = 0, float candidateLogAreaRadius = 0);
 	~MatchingSegmentClassifier();
 
 	/**
@@ -75,6 +150,12 @@ public:
 	 */
 	int predict(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask, int *nearestNeighborIndex = NULL, vector<std::tuple<int, int, double> > *bestMatching = NULL);
 
+	/**
+	 * Returns the maximum difference between the similarity lookup table
+	 * and the fuzzy engine, see FuzzyLookupTable::maxError.
+	 */
+	double similarityTableError(int randomSamples = 1000);
+
 	/**
 	 * Computes a similarity matrix between each samples using matching
 	 * segments similarity.
@@ -5,7 +5,7 @@ MultipleGraphsClassifier::MultipleGraphsClassifier(vector<std::tuple<SegmentLabe
 {
 }
 
-WeightedGraph MultipleGraphsClassifier::computeFeatureGraph(int feature, DisjointSetForest &segmentation, const Mat_<Vec3b> &image, const Mat_<float> &mask) {
+WeightedGraph MultipleGraphsClassifier::computeFeatureGraph(int feature, DisjointSetForest &segmentation, const Mat_<Vec3b> &image, const Mat_<float> &mask, GraphArena *arena) {
 	vector<VectorXd> featureVectors = get<0>(this->features[feature])(segmentation, image, mask);
 	MatrixXd similarityMatrix = MatrixXd::Zero(segmentation.getNumberOfComponents() - 1, segmentation.getNumberOfComponents() - 1);
 
@@ -19,7 +19,7 @@ WeightedGraph MultipleGraphsClassifier::computeFeatureGraph(int feature, Disjoin
 
 	// compute k nearest neighbor graph from similarity matrix
 	KNearestGraph kNearest(min(20, segmentation.getNumberOfComponents() - 1));
-	WeightedGraph featureGraph;
+	WeightedGraph featureGraph(0, -1, arena);
 	DenseSimilarityMatrix denseSimMat(&similarityMatrix);
 
 	kNearest(denseSimMat, featureGraph);
@@ -69,12 +69,14 @@ int MultipleGraphsClassifier::predict(DisjointSetForest &segmentation, const Mat
 		exit(EXIT_FAILURE);
 	}
 
-	// compute each feature graph for the test sample
+	// compute each feature graph for the test sample, they do not outlive
+	// the prediction so they can be allocated from a local arena.
+	GraphArena arena;
 	vector<WeightedGraph> featureGraphs;
 	featureGraphs.reserve(this->features.size());
 
 	for (int i = 0; i < (int)this->features.size(); i++) {
-		featureGraphs.push_back(this->computeFeatureGraph(i, segmentation, image, mask));
+		featureGraphs.push_back(this->computeFeatureGraph(i, segmentation, image, mask, &arena));
 	}
 
 	// order graphs by feature, to compute pattern vectors feature by
@@ -36,9 +36,10 @@ private:
 	 * @param segmentation segmentation of the image.
 	 * @param image segmented image.
 	 * @param mask mask of the image.
+	 * @param arena optional arena for the adjacency lists of the feature graph.
 	 * @return the corresponding feature graph.
 	 */
-	WeightedGraph computeFeatureGraph(int feature, DisjointSetForest &segmentation, const Mat_<Vec3b> &image, const Mat_<float> &mask);
+	WeightedGraph computeFeatureGraph(int feature, DisjointSetForest &segmentation, const Mat_<Vec3b> &image, const Mat_<float> &mask, GraphArena *arena = NULL);
 
 public:
 	/**
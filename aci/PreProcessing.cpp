@@ -8,7 +8,8 @@ static double constOne(const Mat& m1, const Mat& m2) {
 
 static void removeSmallComponents(const Mat_<float> &mask, Mat_<float> &connectedMask) {
 	Mat_<Vec3b> dummy(mask.rows, mask.cols);
-	WeightedGraph grid = gridGraph(dummy, CONNECTIVITY_4, mask, constOne, true);
+	GraphArena arena;
+	WeightedGraph grid = gridGraph(dummy, CONNECTIVITY_4, mask, constOne, true, &arena);
 	vector<int> inCC;
 	int nbCC;
 	vector<WeightedGraph> components;
@@ -60,25 +61,19 @@ void preProcessing(const Mat_<Vec3b> &rawImage, const Mat_<float> &rawMask, Mat_
 		imshow("equalized", equalized);
 		imshow("filtered", filtered);
 		imshow("filteredFloat", filteredFloat);
-		vector<Mat_<float> > channels;
+		ColorPlanes colorPlanes(processedImage);
 
-		split(processedImage, channels);
-
-		imshow("L", channels[0]/100.);
-		imshow("a", (channels[1] + 127.)/256.);
-		imshow("b", (channels[2] + 127.)/256.);
+		imshow("L", colorPlanes.getLabPlane(0)/100.);
+		imshow("a", (colorPlanes.getLabPlane(1) + 127.)/256.);
+		imshow("b", (colorPlanes.getLabPlane(2) + 127.)/256.);
 
+		// hue of the filtered image itself, rather than of its L*a*b*
+		// round trip.
 		Mat_<Vec3f> hsv;
-
-		cout<<"converting"<<endl;
-		cvtColor(filteredFloat, hsv, CV_BGR2HSV);
-
 		vector<Mat_<float> > hsvChannels;
 
-		cout<<"splitting"<<endl;
+		cvtColor(filteredFloat, hsv, CV_BGR2HSV);
 		split(hsv, hsvChannels);
-
-		cout<<"displaying"<<endl;
 		imshow("hue", hsvChannels[0] / 360.);
 
 		waitKey(0);
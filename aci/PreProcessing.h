@@ -8,6 +8,7 @@
 #include "Utils.hpp"
 #include "KuwaharaFilter.h"
 #include "ImageGraphs.h"
+#include "ColorPlanes.h"
 
 #define DEFAULT_KUWAHARA_HALFSIZE 5
 #define DEFAULT_MAX_NB_PIXELS 15000
@@ -4,27 +4,19 @@
 #define DEBUG_ATTRIBUTES false
 
 vector<VectorXd> averageColorLabeling(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask) {
-	vector<VectorXd> averageColor;
-	averageColor.reserve(segmentation.getNumberOfComponents());
-	
-	for (int i = 0; i < segmentation.getNumberOfComponents(); i++) {
-		VectorXd zeros = VectorXd::Zero(3);
-		averageColor.push_back(zeros);
-	}
-	map<int,int> rootIndexes = segmentation.getRootIndexes();
+	return averageColorLabeling(SegmentStatistics(segmentation, image, mask, Mat_<float>(), COLOR_STATISTICS));
+}
 
-	for (int i = 0; i < image.rows; i++) {
-		for (int j = 0; j < image.cols; j++) {
-			if (mask(i,j) > 0) {
-				int root = segmentation.find(toRowMajor(image.cols, j, i));
-				int segmentIndex = rootIndexes[root];
-				VectorXd pixColor(3);
-				pixColor(0) = image(i,j)[0];
-				pixColor(1) = image(i,j)[1];
-				pixColor(2) = image(i,j)[2];
-
-				averageColor[segmentIndex] += pixColor / (float)segmentation.getComponentSize(root);
-			}
+vector<VectorXd> averageColorLabeling(const SegmentStatistics &statistics) {
+	vector<VectorXd> averageColor(statistics.getNumberOfSegments());
+
+	for (int s = 0; s < statistics.getNumberOfSegments(); s++) {
+		double segmentSize = (double)statistics.getAreas()[s];
+
+		averageColor[s] = VectorXd(3);
+
+		for (int c = 0; c < 3; c++) {
+			averageColor[s](c) = statistics.getColorSums(c)[s] / segmentSize;
 		}
 	}
 
@@ -32,49 +24,42 @@ vector<VectorXd> averageColorLabeling(DisjointSetForest &segmentation, const Mat
 }
 
 vector<VectorXd> averageHueLabeling(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask) {
-	Mat_<Vec3f> rgb, hsv;
+	ColorPlanes colorPlanes(image);
 
-	cvtColor(image, rgb, CV_Lab2RGB);
-	cvtColor(rgb, hsv, CV_RGB2HSV);
+	return averageHueLabeling(segmentation, colorPlanes, mask);
+}
 
-	vector<Mat_<float> > channels;
+vector<VectorXd> averageHueLabeling(DisjointSetForest &segmentation, ColorPlanes &colorPlanes, const Mat_<float> &mask) {
+	// only hues are gathered, as fuseByHue labels segments this way after
+	// every pass.
+	return averageHueLabeling(SegmentStatistics(segmentation, colorPlanes.getLab(), mask, colorPlanes.getHSVPlane(0), 0));
+}
 
-	split(hsv, channels);
+vector<VectorXd> averageHueLabeling(const SegmentStatistics &statistics) {
+	assert(statistics.hasStatistics(HUE_STATISTICS));
+	vector<VectorXd> averageHues(statistics.getNumberOfSegments());
 
-	vector<VectorXd> averageHues;
-	averageHues.reserve(segmentation.getNumberOfComponents());
-	for (int i = 0; i < segmentation.getNumberOfComponents(); i++) {
-		averageHues.push_back(VectorXd::Zero(1));
-	}
-	map<int,int> rootIndexes = segmentation.getRootIndexes();
-
-	for (int i = 0; i < image.rows; i++) {
-		for (int j = 0; j < image.cols; j++) {
-			if (mask(i,j) > 0) {
-				int root = segmentation.find(toRowMajor(image.cols, j, i));
-				
-				averageHues[rootIndexes[root]](0) += channels[0](i,j) / (double)segmentation.getComponentSize(root);
-			}
-		}
+	for (int s = 0; s < statistics.getNumberOfSegments(); s++) {
+		averageHues[s] = VectorXd(1);
+		averageHues[s](0) = statistics.getHueSums()[s] / (double)statistics.getAreas()[s];
 	}
 
 	return averageHues;
 }
 
 vector<VectorXd> gravityCenterLabeling(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask) {
-	vector<Vec2f> centers;
-	gravityCenters(image, mask, segmentation, centers);
-
-	vector<VectorXd> eigCenters;
-	eigCenters.reserve(centers.size());
+	return gravityCenterLabeling(SegmentStatistics(segmentation, image, mask, Mat_<float>(), POSITION_STATISTICS));
+}
 
-	for (int i = 0; i < (int)centers.size(); i++) {
-		VectorXd center(2);
+vector<VectorXd> gravityCenterLabeling(const SegmentStatistics &statistics) {
+	vector<VectorXd> eigCenters(statistics.getNumberOfSegments());
 
-		center(0) = centers[i](0) / (double)image.rows;
-		center(1) = centers[i](1) / (double)image.cols;
+	for (int s = 0; s < statistics.getNumberOfSegments(); s++) {
+		double segmentSize = (double)statistics.getAreas()[s];
 
-		eigCenters.push_back(center);
+		eigCenters[s] = VectorXd(2);
+		eigCenters[s](0) = statistics.getRowSums()[s] / segmentSize / (double)statistics.getRows();
+		eigCenters[s](1) = statistics.getColSums()[s] / segmentSize / (double)statistics.getCols();
 	}
 
 	return eigCenters;
@@ -82,87 +67,153 @@ vector<VectorXd> gravityCenterLabeling(DisjointSetForest &segmentation, const Ma
 
 vector<VectorXd> segmentAreaLabeling(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask) {
 	vector<VectorXd> areas(segmentation.getNumberOfComponents());
-	map<int,int> roots = segmentation.getRootIndexes();
+	const vector<int> &segmentRoots = segmentation.getSegmentRoots();
 
-	for (map<int,int>::iterator it = roots.begin(); it != roots.end(); it++) {
-		int root = (*it).first;
+	for (int i = 0; i < (int)segmentRoots.size(); i++) {
 		VectorXd area(1);
-		area(0) = (double)segmentation.getComponentSize(root);
+		area(0) = (double)segmentation.getComponentSize(segmentRoots[i]);
 
-		areas[(*it).second] = area;
+		areas[i] = area;
 	}
 
 	return areas;
 }
 
-void pixelsCovarianceMatrixLabels(const Mat_<Vec3b> &image, const Mat_<float> &mask, DisjointSetForest &segmentation, const WeightedGraph &segGraph, LabeledGraph<Matx<float, 3, 1> > &labeledGraph) {
-	assert(segmentation.getNumberOfComponents() == segGraph.numberOfVertices());
-	vector<Mat> segmentSamples(segmentation.getNumberOfComponents());
-	map<int,int> rootIndexes = segmentation.getRootIndexes();
+vector<VectorXd> segmentAreaLabeling(const SegmentStatistics &statistics) {
+	vector<VectorXd> areas(statistics.getNumberOfSegments());
 
-	for (int i = 0; i < image.rows; i++) {
-		for (int j = 0; j < image.cols; j++) {
-			Mat coords(1,2,CV_32F);
+	for (int s = 0; s < statistics.getNumberOfSegments(); s++) {
+		areas[s] = VectorXd(1);
+		areas[s](0) = (double)statistics.getAreas()[s];
+	}
+
+	return areas;
+}
+
+/**
+ * Computes the ellipse descriptor of a set of pixels from the first and
+ * second moments of their coordinates: its axes are twice the standard
+ * deviations along the eigenvectors of the covariance matrix, found in
+ * closed form as it is 2 by 2.
+ *
+ * @return the major and minor axes relative to the image diagonal, and the
+ * angle in radians between the major axis and the row axis.
+ */
+static Matx<float, 3, 1> ellipseDescriptor(double n, double rowSum, double colSum, double rowRowSum, double rowColSum, double colColSum, int rows, int cols, Vec2d *mean = NULL) {
+	Matx<float, 3, 1> descriptor(0, 0, 0);
+
+	if (n <= 0) {
+		return descriptor;
+	}
 
-			coords.at<float>(0,0) = (float)i;
-			coords.at<float>(0,1) = (float)j;
+	double meanRow = rowSum / n;
+	double meanCol = colSum / n;
+	double varRow = rowRowSum / n - meanRow * meanRow;
+	double covariance = rowColSum / n - meanRow * meanCol;
+	double varCol = colColSum / n - meanCol * meanCol;
+
+	double halfTrace = (varRow + varCol) / 2;
+	double discriminant = sqrt(pow((varRow - varCol) / 2, 2) + covariance * covariance);
+	double eigenvalue1 = halfTrace + discriminant;
+	double eigenvalue2 = max(halfTrace - discriminant, 0.);
+
+	// eigenvector of the largest eigenvalue, with a non negative column
+	// component so the angle is in [0;pi].
+	double evRow, evCol;
+
+	if (covariance != 0) {
+		evRow = eigenvalue1 - varCol;
+		evCol = covariance;
+	} else if (varRow >= varCol) {
+		evRow = 1;
+		evCol = 0;
+	} else {
+		evRow = 0;
+		evCol = 1;
+	}
+	double evNorm = sqrt(evRow * evRow + evCol * evCol);
 
-			int root = segmentation.find(toRowMajor(image.cols, j, i));
-			int segmentIndex = rootIndexes[root];
+	if (evCol < 0) {
+		evRow = -evRow;
+	}
 
-			if (segmentSamples[segmentIndex].empty()) {
-				segmentSamples[segmentIndex] = coords;
-			} else {
-				Mat tmp;
+	double diagonal = sqrt(pow(rows, 2.) + pow(cols, 2.));
 
-				vconcat(segmentSamples[segmentIndex], coords, tmp);
+	descriptor(0,0) = (float)(2 * sqrt(eigenvalue1) / diagonal);
+	descriptor(1,0) = (float)(2 * sqrt(eigenvalue2) / diagonal);
+	descriptor(2,0) = (float)acos(min(max(evRow / evNorm, -1.), 1.));
 
-				segmentSamples[segmentIndex] = tmp;
-			}
-		}
+	if (mean != NULL) {
+		*mean = Vec2d(meanRow, meanCol);
 	}
 
-	Mat_<Vec3b> regionImage = segmentation.toRegionImage(image);
-	labeledGraph = LabeledGraph<Matx<float, 3, 1> >(segGraph.numberOfVertices());
-	labeledGraph.copyEdges(segGraph);
+	return descriptor;
+}
 
-	for (int i = 0; i < segmentation.getNumberOfComponents(); i++) {
-		Mat covarianceMatrix(0, 0, CV_32F);
-		Mat mean(0,0,CV_32F);
+vector<VectorXd> ellipseLabeling(const SegmentStatistics &statistics) {
+	vector<VectorXd> ellipses(statistics.getNumberOfSegments());
 
-		calcCovarMatrix(segmentSamples[i], covarianceMatrix, mean, CV_COVAR_NORMAL | CV_COVAR_ROWS | CV_COVAR_SCALE, CV_32F);
+	for (int s = 0; s < statistics.getNumberOfSegments(); s++) {
+		Matx<float, 3, 1> descriptor = ellipseDescriptor(
+			statistics.getMaskedAreas()[s],
+			statistics.getRowSums()[s], statistics.getColSums()[s],
+			statistics.getRowRowSums()[s], statistics.getRowColSums()[s], statistics.getColColSums()[s],
+			statistics.getRows(), statistics.getCols());
 
-		Mat eigenvalues;
-		Mat eigenvectors;
+		ellipses[s] = VectorXd(3);
 
-		eigen(covarianceMatrix, eigenvalues, eigenvectors);
+		for (int k = 0; k < 3; k++) {
+			ellipses[s](k) = descriptor(k,0);
+		}
+	}
 
-		float axis1 = 2 * sqrt(eigenvalues.at<float>(0,0));
-		float axis2 = 2 * sqrt(eigenvalues.at<float>(1,0));
-		Mat ev1;
-		Mat ev2;
-		Mat horizontal(1,2,CV_32F);
-		horizontal.at<float>(0,0) = 1;
-		horizontal.at<float>(0,1) = 0;
-		normalize(eigenvectors.row(0), ev1);
-		normalize(eigenvectors.row(1), ev2);
-		float angle = (float)acos(horizontal.dot(ev1));
+	return ellipses;
+}
 
-		if (DEBUG_ATTRIBUTES) {
-			float degreeAngle = angle * 180 / M_PI;
-			cout<<"angle = "<<angle<<" radians and "<<degreeAngle<<" degrees"<<endl;
-			ellipse(regionImage, Point((int)mean.at<float>(0,1), (int)mean.at<float>(0,0)), Size((int)axis2, (int)axis1), degreeAngle, 0, 360, Scalar(0,0,255), 2);
+void pixelsCovarianceMatrixLabels(const Mat_<Vec3b> &image, const Mat_<float> &mask, DisjointSetForest &segmentation, const WeightedGraph &segGraph, LabeledGraph<Matx<float, 3, 1> > &labeledGraph) {
+	assert(segmentation.getNumberOfComponents() == segGraph.numberOfVertices());
+	int numberOfSegments = segmentation.getNumberOfComponents();
+	const vector<int> &segmentIndexes = segmentation.getSegmentIndexes();
+	vector<double> counts(numberOfSegments, 0);
+	vector<double> rowSums(numberOfSegments, 0), colSums(numberOfSegments, 0);
+	vector<double> rowRowSums(numberOfSegments, 0), rowColSums(numberOfSegments, 0), colColSums(numberOfSegments, 0);
+
+	// running moments of the coordinates of each segment's pixels, in one
+	// pass over the image.
+	for (int i = 0; i < image.rows; i++) {
+		for (int j = 0; j < image.cols; j++) {
+			int s = segmentIndexes[toRowMajor(image.cols, j, i)];
+
+			counts[s]++;
+			rowSums[s] += i;
+			colSums[s] += j;
+			rowRowSums[s] += (double)i * i;
+			rowColSums[s] += (double)i * j;
+			colColSums[s] += (double)j * j;
 		}
+	}
+
+	labeledGraph = LabeledGraph<Matx<float, 3, 1> >(segGraph.numberOfVertices());
+	labeledGraph.copyEdges(segGraph);
+	Mat_<Vec3b> regionImage;
 
-		double diagonal = sqrt(pow(image.rows,2.) + pow(image.cols,2.));
+	if (DEBUG_ATTRIBUTES) {
+		regionImage = segmentation.toRegionImage(image);
+	}
 
-		Matx<float, 3, 1> ellipseDescriptor(3, 1);
+	for (int i = 0; i < numberOfSegments; i++) {
+		Vec2d mean;
+		Matx<float, 3, 1> descriptor = ellipseDescriptor(counts[i], rowSums[i], colSums[i], rowRowSums[i], rowColSums[i], colColSums[i], image.rows, image.cols, &mean);
 
-		ellipseDescriptor(0,0) = axis1 / diagonal;
-		ellipseDescriptor(1,0) = axis2 / diagonal;
-		ellipseDescriptor(2,0) = angle;
+		if (DEBUG_ATTRIBUTES) {
+			double diagonal = sqrt(pow(image.rows,2.) + pow(image.cols,2.));
+			float angle = descriptor(2,0);
+			float degreeAngle = (float)(angle * 180 / M_PI);
+			cout<<"angle = "<<angle<<" radians and "<<degreeAngle<<" degrees"<<endl;
+			ellipse(regionImage, Point((int)mean[1], (int)mean[0]), Size((int)(descriptor(1,0) * diagonal), (int)(descriptor(0,0) * diagonal)), degreeAngle, 0, 360, Scalar(0,0,255), 2);
+		}
 
-		labeledGraph.addLabel(i, ellipseDescriptor);
+		labeledGraph.addLabel(i, descriptor);
 	}
 
 	if (DEBUG_ATTRIBUTES) {
@@ -9,6 +9,8 @@
 #include "LabeledGraph.hpp"
 #include "DisjointSet.hpp"
 #include "GraphPartitions.h"
+#include "ColorPlanes.h"
+#include "SegmentStatistics.h"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -21,22 +23,77 @@ using namespace Eigen;
  */
 typedef vector<VectorXd> (*SegmentLabeling)(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask);
 
+/**
+ * Datatype for segment labelling function associating vectors to each
+ * segment from statistics gathered beforehand, so several labelings of
+ * the same segmentation only scan the image once.
+ */
+typedef vector<VectorXd> (*SegmentStatisticsLabeling)(const SegmentStatistics &statistics);
+
 /**
  * Labels segments by their average color.
  */
 vector<VectorXd> averageColorLabeling(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask);
 
+/**
+ * Labels segments by their average color, from their statistics.
+ */
+vector<VectorXd> averageColorLabeling(const SegmentStatistics &statistics);
+
 /**
  * Labels segments by their average hue.
  */
 vector<VectorXd> averageHueLabeling(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask);
 
+/**
+ * Labels segments by their average hue, taking the hue plane from a color
+ * plane cache so the image is converted at most once.
+ */
+vector<VectorXd> averageHueLabeling(DisjointSetForest &segmentation, ColorPlanes &colorPlanes, const Mat_<float> &mask);
+
+/**
+ * Labels segments by their average hue, from statistics gathered with
+ * the hue plane of the image, see SegmentStatistics::hasStatistics.
+ */
+vector<VectorXd> averageHueLabeling(const SegmentStatistics &statistics);
+
 /**
  * Labels segments by their gravity center.
  */
 vector<VectorXd> gravityCenterLabeling(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask);
 
+/**
+ * Labels segments by their gravity center, from their statistics.
+ */
+vector<VectorXd> gravityCenterLabeling(const SegmentStatistics &statistics);
+
 /**
  * Labels segments by their area in number of pixels.
  */
 vector<VectorXd> segmentAreaLabeling(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask);
+
+/**
+ * Labels segments by their area in number of pixels, from their statistics.
+ */
+vector<VectorXd> segmentAreaLabeling(const SegmentStatistics &statistics);
+
+/**
+ * Labels segments by the ellipse fitted to their pixels in the mask: its
+ * major and minor axes relative to the image diagonal, and the angle of its
+ * major axis. Computed in closed form from the moments of pixel coordinates.
+ */
+vector<VectorXd> ellipseLabeling(const SegmentStatistics &statistics);
+
+/**
+ * Labels the vertices of a segmentation graph by the ellipse fitted to the
+ * pixels of each segment, as ellipseLabeling does, in one pass over the
+ * image.
+ *
+ * @param image the segmented image.
+ * @param mask mask of the image.
+ * @param segmentation a segmentation of the image.
+ * @param segGraph segmentation graph of the segmentation.
+ * @param labeledGraph output graph with the edges of segGraph, labeled by
+ * ellipse descriptors.
+ */
+void pixelsCovarianceMatrixLabels(const Mat_<Vec3b> &image, const Mat_<float> &mask, DisjointSetForest &segmentation, const WeightedGraph &segGraph, LabeledGraph<Matx<float, 3, 1> > &labeledGraph);
@@ -0,0 +1,40 @@
+#include "SegmentFeatures.h"
+
+SegmentFeature::~SegmentFeature() {
+
+}
+
+int SegmentLabels::numberOfSegments() const {
+	return this->blocks.empty() ? 0 : (int)this->blocks[0].cols();
+}
+
+void averageColorFeature(const SegmentStatistics &statistics, Matrix<float, 3, Dynamic> &block) {
+	block.resize(3, statistics.getNumberOfSegments());
+
+	for (int s = 0; s < statistics.getNumberOfSegments(); s++) {
+		double segmentSize = (double)statistics.getAreas()[s];
+
+		for (int c = 0; c < 3; c++) {
+			block(c,s) = (float)(statistics.getColorSums(c)[s] / segmentSize);
+		}
+	}
+}
+
+void segmentAreaFeature(const SegmentStatistics &statistics, Matrix<float, 1, Dynamic> &block) {
+	block.resize(1, statistics.getNumberOfSegments());
+
+	for (int s = 0; s < statistics.getNumberOfSegments(); s++) {
+		block(0,s) = (float)statistics.getAreas()[s];
+	}
+}
+
+void gravityCenterFeature(const SegmentStatistics &statistics, Matrix<float, 2, Dynamic> &block) {
+	block.resize(2, statistics.getNumberOfSegments());
+
+	for (int s = 0; s < statistics.getNumberOfSegments(); s++) {
+		double segmentSize = (double)statistics.getAreas()[s];
+
+		block(0,s) = (float)(statistics.getRowSums()[s] / segmentSize / (double)statistics.getRows());
+		block(1,s) = (float)(statistics.getColSums()[s] / segmentSize / (double)statistics.getCols());
+	}
+}
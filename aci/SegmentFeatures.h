@@ -0,0 +1,149 @@
+/** @file */
+#pragma once
+
+#include <Eigen/Dense>
+
+#include "SegmentStatistics.h"
+
+using namespace std;
+using namespace Eigen;
+
+/**
+ * Feature labeling each segment of an image with a vector. The labels of
+ * all segments are stored in a contiguous block with one column per
+ * segment. Implementations know the dimension of their labels at compile
+ * time, see FixedSegmentFeature, so the classifier can keep features of
+ * different dimensions in one list while distances are computed by fixed
+ * size kernels.
+ */
+class SegmentFeature {
+public:
+	virtual ~SegmentFeature();
+
+	/**
+	 * Returns the dimension of the labels.
+	 */
+	virtual int dimension() const = 0;
+
+	/**
+	 * Labels each segment of an image.
+	 *
+	 * @param statistics statistics of the segments of the image.
+	 * @param block output dimension() by number of segments matrix.
+	 */
+	virtual void compute(const SegmentStatistics &statistics, MatrixXf &block) const = 0;
+
+	/**
+	 * Computes the squared norm of the label of each segment.
+	 *
+	 * @param block labels of the segments of an image, in double precision.
+	 * @param squaredNorms output vector of the squared norm of each column.
+	 */
+	virtual void squaredNorms(const MatrixXd &block, VectorXd &squaredNorms) const = 0;
+
+	/**
+	 * Computes the squared euclidean distance between the labels of each
+	 * pair of segments from 2 images, expanding it as
+	 * |l|^2 + |s|^2 - 2 l.s so all pairs are computed by one matrix product.
+	 * Products are computed in double precision, as features such as areas
+	 * are large enough for the expansion to cancel out in float, from labels
+	 * converted once per image, see SegmentLabels.
+	 *
+	 * @param lBlock labels of the segments of the first image.
+	 * @param lSquaredNorms squared norms of the labels of the first image.
+	 * @param sBlock labels of the segments of the second image.
+	 * @param sSquaredNorms squared norms of the labels of the second image.
+	 * @param start index of the first segment to consider in both images.
+	 * Entries for pairs involving previous segments are 0.
+	 * @param distances output matrix of the squared distance between segment
+	 * i of the first image and j of the second one at (i,j).
+	 */
+	virtual void squaredDistances(const MatrixXd &lBlock, const VectorXd &lSquaredNorms, const MatrixXd &sBlock, const VectorXd &sSquaredNorms, int start, MatrixXd &distances) const = 0;
+};
+
+/**
+ * Segment feature of dimension D computed from segment statistics by a
+ * labeling function writing into a fixed size block.
+ */
+template < int D >
+class FixedSegmentFeature : public SegmentFeature {
+public:
+	typedef Matrix<float, D, Dynamic> Block;
+	typedef Matrix<double, D, Dynamic> DoubleBlock;
+	typedef void (*Labeling)(const SegmentStatistics &statistics, Block &block);
+
+private:
+	Labeling labeling;
+
+public:
+	FixedSegmentFeature(Labeling labeling)
+		: labeling(labeling)
+	{
+
+	}
+
+	int dimension() const {
+		return D;
+	}
+
+	void compute(const SegmentStatistics &statistics, MatrixXf &block) const {
+		Block typedBlock(D, statistics.getNumberOfSegments());
+
+		this->labeling(statistics, typedBlock);
+		block = typedBlock;
+	}
+
+	void squaredNorms(const MatrixXd &block, VectorXd &squaredNorms) const {
+		assert(block.rows() == D);
+		Map<const DoubleBlock> labels(block.data(), D, block.cols());
+
+		squaredNorms = labels.colwise().squaredNorm().transpose();
+	}
+
+	void squaredDistances(const MatrixXd &lBlock, const VectorXd &lSquaredNorms, const MatrixXd &sBlock, const VectorXd &sSquaredNorms, int start, MatrixXd &distances) const {
+		assert(lBlock.rows() == D && sBlock.rows() == D);
+		// the dynamic blocks are viewed with their static number of rows.
+		Map<const DoubleBlock> lLabels(lBlock.data(), D, lBlock.cols());
+		Map<const DoubleBlock> sLabels(sBlock.data(), D, sBlock.cols());
+
+		distances.noalias() = -2 * lLabels.transpose() * sLabels;
+		distances.colwise() += lSquaredNorms;
+		distances.rowwise() += sSquaredNorms.transpose();
+		// rounding may leave slightly negative distances between equal labels.
+		distances = distances.cwiseMax(0.);
+		distances.topRows(start).setZero();
+		distances.leftCols(start).setZero();
+	}
+};
+
+/**
+ * Labels of the segments of an image for each feature of a feature set,
+ * along with their double precision conversion and squared norms, so they
+ * are computed once per image rather than once per comparison.
+ */
+struct SegmentLabels {
+	// labels of each feature, with one column per segment.
+	vector<MatrixXf> blocks;
+	// labels of each feature in double precision, which distances are
+	// computed from.
+	vector<MatrixXd> doubleBlocks;
+	// squared norm of the label of each segment, for each feature.
+	vector<VectorXd> squaredNorms;
+
+	int numberOfSegments() const;
+};
+
+/**
+ * Labels segments by their average color.
+ */
+void averageColorFeature(const SegmentStatistics &statistics, Matrix<float, 3, Dynamic> &block);
+
+/**
+ * Labels segments by their area in number of pixels.
+ */
+void segmentAreaFeature(const SegmentStatistics &statistics, Matrix<float, 1, Dynamic> &block);
+
+/**
+ * Labels segments by their gravity center, relative to the image size.
+ */
+void gravityCenterFeature(const SegmentStatistics &statistics, Matrix<float, 2, Dynamic> &block);
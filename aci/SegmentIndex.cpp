@@ -0,0 +1,110 @@
+#include "SegmentIndex.h"
+
+SegmentIndex::SegmentIndex()
+	: positionRadius(0), logAreaRadius(0), positionCells(0), areaCells(0), minLogArea(0)
+{
+
+}
+
+SegmentIndex::SegmentIndex(const MatrixXf &centers, const MatrixXf &areas, int start, float positionRadius, float logAreaRadius)
+	: positionRadius(positionRadius),
+	logAreaRadius(logAreaRadius),
+	positionCells(max(1, (int)ceil(1.f / positionRadius))),
+	areaCells(1),
+	minLogArea(0),
+	rows(centers.cols(), 0),
+	cols(centers.cols(), 0),
+	logAreas(centers.cols(), 0)
+{
+	assert(centers.rows() == 2 && areas.rows() == 1 && centers.cols() == areas.cols());
+	assert(positionRadius > 0 && logAreaRadius > 0);
+	int nbSegments = (int)centers.cols();
+	float maxLogArea = 0;
+
+	for (int s = start; s < nbSegments; s++) {
+		this->rows[s] = centers(0,s);
+		this->cols[s] = centers(1,s);
+		this->logAreas[s] = log(max(areas(0,s), 1.f));
+
+		if (s == start || this->logAreas[s] < this->minLogArea) {
+			this->minLogArea = this->logAreas[s];
+		}
+		if (s == start || this->logAreas[s] > maxLogArea) {
+			maxLogArea = this->logAreas[s];
+		}
+	}
+
+	if (start < nbSegments) {
+		this->areaCells = (int)floor((maxLogArea - this->minLogArea) / logAreaRadius) + 1;
+	}
+
+	// counting sort of the segments by cell.
+	vector<int> segmentCells(nbSegments, 0);
+	this->cellOffsets.assign(this->positionCells * this->positionCells * this->areaCells + 1, 0);
+
+	for (int s = start; s < nbSegments; s++) {
+		segmentCells[s] = this->cellIndex(
+			this->positionCell(this->rows[s]),
+			this->positionCell(this->cols[s]),
+			this->areaCell(this->logAreas[s]));
+		this->cellOffsets[segmentCells[s] + 1]++;
+	}
+
+	for (int c = 0; c < (int)this->cellOffsets.size() - 1; c++) {
+		this->cellOffsets[c + 1] += this->cellOffsets[c];
+	}
+
+	vector<int> cellEnds(this->cellOffsets.begin(), this->cellOffsets.end() - 1);
+	this->cellSegments.resize(nbSegments - min(start, nbSegments));
+
+	for (int s = start; s < nbSegments; s++) {
+		this->cellSegments[cellEnds[segmentCells[s]]++] = s;
+	}
+}
+
+bool SegmentIndex::isBuilt() const {
+	return !this->cellOffsets.empty();
+}
+
+int SegmentIndex::cellIndex(int row, int col, int area) const {
+	return (row * this->positionCells + col) * this->areaCells + area;
+}
+
+int SegmentIndex::positionCell(float position) const {
+	return min(max((int)floor(position / this->positionRadius), 0), this->positionCells - 1);
+}
+
+int SegmentIndex::areaCell(float logArea) const {
+	return min(max((int)floor((logArea - this->minLogArea) / this->logAreaRadius), 0), this->areaCells - 1);
+}
+
+void SegmentIndex::candidates(float row, float col, float area, vector<int> &candidates) const {
+	assert(this->isBuilt());
+	candidates.clear();
+	float logArea = log(max(area, 1.f));
+	float squaredRadius = this->positionRadius * this->positionRadius;
+	// the query may lie outside of the indexed log-area range, in which case
+	// clamping to the border cells only scans cells which can't match.
+	int minAreaCell = this->areaCell(logArea - this->logAreaRadius);
+	int maxAreaCell = this->areaCell(logArea + this->logAreaRadius);
+
+	for (int i = this->positionCell(row - this->positionRadius); i <= this->positionCell(row + this->positionRadius); i++) {
+		for (int j = this->positionCell(col - this->positionRadius); j <= this->positionCell(col + this->positionRadius); j++) {
+			for (int a = minAreaCell; a <= maxAreaCell; a++) {
+				int cell = this->cellIndex(i, j, a);
+
+				for (int k = this->cellOffsets[cell]; k < this->cellOffsets[cell + 1]; k++) {
+					int s = this->cellSegments[k];
+					float dRow = this->rows[s] - row;
+					float dCol = this->cols[s] - col;
+
+					if (dRow * dRow + dCol * dCol <= squaredRadius && fabs(this->logAreas[s] - logArea) <= this->logAreaRadius) {
+						candidates.push_back(s);
+					}
+				}
+			}
+		}
+	}
+
+	sort(candidates.begin(), candidates.end());
+}
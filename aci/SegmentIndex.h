@@ -0,0 +1,75 @@
+/** @file */
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Dense>
+
+using namespace std;
+using namespace Eigen;
+
+/**
+ * Spatial index of the segments of an image by gravity center, relative to
+ * the image size, and logarithm of their area. Segments are bucketed in a
+ * regular grid whose cells are as large as the query radii, so the segments
+ * close to a query point are found by scanning its cell and the adjacent
+ * ones instead of all segments.
+ */
+class SegmentIndex {
+private:
+	float positionRadius;
+	float logAreaRadius;
+	// number of cells along each axis of the centers and along log-areas.
+	int positionCells;
+	int areaCells;
+	float minLogArea;
+	// segments of each cell in cellSegments[cellOffsets[c]..cellOffsets[c+1]),
+	// cells ordered by row, column then log-area.
+	vector<int> cellOffsets;
+	vector<int> cellSegments;
+	// center and log-area of each segment.
+	vector<float> rows;
+	vector<float> cols;
+	vector<float> logAreas;
+
+	int cellIndex(int row, int col, int area) const;
+
+	int positionCell(float position) const;
+
+	int areaCell(float logArea) const;
+
+public:
+	SegmentIndex();
+
+	/**
+	 * Indexes the segments of an image.
+	 *
+	 * @param centers 2 by number of segments matrix of gravity centers,
+	 * relative to the image size, see gravityCenterFeature.
+	 * @param areas 1 by number of segments matrix of areas in pixels, see
+	 * segmentAreaFeature.
+	 * @param start index of the first segment to index.
+	 * @param positionRadius maximum distance between the centers of the
+	 * query and candidate segments.
+	 * @param logAreaRadius maximum difference between the logarithms of the
+	 * areas of the query and candidate segments.
+	 */
+	SegmentIndex(const MatrixXf &centers, const MatrixXf &areas, int start, float positionRadius, float logAreaRadius);
+
+	/**
+	 * Returns true iff segments have been indexed.
+	 */
+	bool isBuilt() const;
+
+	/**
+	 * Finds the indexed segments within the radii of a query segment.
+	 *
+	 * @param row row of the gravity center of the query segment.
+	 * @param col column of the gravity center of the query segment.
+	 * @param area area of the query segment in pixels.
+	 * @param candidates output indexes of the candidate segments, in
+	 * increasing order.
+	 */
+	void candidates(float row, float col, float area, vector<int> &candidates) const;
+};
@@ -0,0 +1,66 @@
+#include "SegmentIndexTest.h"
+
+static float randomFloat(float min, float max) {
+	return min + (max - min) * (float)rand() / (float)RAND_MAX;
+}
+
+/**
+ * Random gravity centers and areas of segments. Centers may lie slightly
+ * outside of the image, and areas span several orders of magnitude.
+ */
+static void randomSegments(int nbSegments, MatrixXf &centers, MatrixXf &areas) {
+	centers = MatrixXf(2, nbSegments);
+	areas = MatrixXf(1, nbSegments);
+
+	for (int s = 0; s < nbSegments; s++) {
+		centers(0,s) = randomFloat(-0.1f, 1.1f);
+		centers(1,s) = randomFloat(-0.1f, 1.1f);
+		areas(0,s) = floor(exp(randomFloat(0, 10)));
+	}
+}
+
+/**
+ * Checks candidate segments against comparing the query to every indexed
+ * segment. Queries are drawn beyond the indexed log-area range, and samples
+ * may have no indexed segment at all.
+ */
+static void testSegmentIndexCandidates() {
+	for (int t = 0; t < 1000; t++) {
+		int nbSegments = rand() % 40;
+		int start = rand() % 3;
+		float positionRadius = randomFloat(0.02f, 0.8f);
+		float logAreaRadius = randomFloat(0.05f, 3);
+		MatrixXf centers, areas;
+
+		randomSegments(nbSegments, centers, areas);
+
+		SegmentIndex index(centers, areas, start, positionRadius, logAreaRadius);
+		assert(index.isBuilt());
+
+		for (int q = 0; q < 20; q++) {
+			float row = randomFloat(-0.5f, 1.5f);
+			float col = randomFloat(-0.5f, 1.5f);
+			float area = floor(exp(randomFloat(-1, 14)));
+			float logArea = log(max(area, 1.f));
+			vector<int> expected;
+			vector<int> actual;
+
+			for (int s = start; s < nbSegments; s++) {
+				float dRow = centers(0,s) - row;
+				float dCol = centers(1,s) - col;
+
+				if (dRow * dRow + dCol * dCol <= positionRadius * positionRadius && fabs(log(max(areas(0,s), 1.f)) - logArea) <= logAreaRadius) {
+					expected.push_back(s);
+				}
+			}
+
+			index.candidates(row, col, area, actual);
+
+			assert(actual == expected);
+		}
+	}
+}
+
+void testSegmentIndex() {
+	testSegmentIndexCandidates();
+}
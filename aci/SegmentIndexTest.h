@@ -0,0 +1,10 @@
+/** @file */
+#pragma once
+
+#include <cassert>
+
+#include "SegmentIndex.h"
+
+using namespace std;
+
+void testSegmentIndex();
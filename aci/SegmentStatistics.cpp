@@ -0,0 +1,135 @@
+#include "SegmentStatistics.h"
+
+SegmentStatistics::SegmentStatistics(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask, const Mat_<float> &hue, int statistics)
+	: rows(image.rows),
+	cols(image.cols),
+	gathered((statistics & (COLOR_STATISTICS | POSITION_STATISTICS)) | (hue.empty() ? 0 : HUE_STATISTICS)),
+	areas(segmentation.getNumberOfComponents()),
+	maskedAreas(segmentation.getNumberOfComponents(), 0)
+{
+	assert(image.rows == mask.rows && image.cols == mask.cols);
+	assert(hue.empty() || (hue.rows == image.rows && hue.cols == image.cols));
+	assert(segmentation.getNumberOfElements() >= image.rows * image.cols);
+	int numberOfSegments = segmentation.getNumberOfComponents();
+	const vector<int> &segmentIndexes = segmentation.getSegmentIndexes();
+	const vector<int> &segmentRoots = segmentation.getSegmentRoots();
+	bool colors = this->hasStatistics(COLOR_STATISTICS);
+	bool hues = this->hasStatistics(HUE_STATISTICS);
+	bool positions = this->hasStatistics(POSITION_STATISTICS);
+
+	if (colors) {
+		for (int c = 0; c < 3; c++) {
+			this->colorSums[c].assign(numberOfSegments, 0);
+		}
+	}
+	if (hues) {
+		this->hueSums.assign(numberOfSegments, 0);
+	}
+	if (positions) {
+		this->rowSums.assign(numberOfSegments, 0);
+		this->colSums.assign(numberOfSegments, 0);
+		this->rowRowSums.assign(numberOfSegments, 0);
+		this->rowColSums.assign(numberOfSegments, 0);
+		this->colColSums.assign(numberOfSegments, 0);
+	}
+	for (int s = 0; s < numberOfSegments; s++) {
+		this->areas[s] = segmentation.getComponentSize(segmentRoots[s]);
+	}
+
+	for (int i = 0; i < image.rows; i++) {
+		const Vec3f *colorRow = image[i];
+		const float *maskRow = mask[i];
+		const float *hueRow = hues ? hue[i] : NULL;
+
+		for (int j = 0; j < image.cols; j++) {
+			if (maskRow[j] <= 0) {
+				continue;
+			}
+			int s = segmentIndexes[toRowMajor(image.cols, j, i)];
+
+			this->maskedAreas[s]++;
+
+			if (colors) {
+				this->colorSums[0][s] += colorRow[j][0];
+				this->colorSums[1][s] += colorRow[j][1];
+				this->colorSums[2][s] += colorRow[j][2];
+			}
+			if (hues) {
+				this->hueSums[s] += hueRow[j];
+			}
+			if (positions) {
+				this->rowSums[s] += i;
+				this->colSums[s] += j;
+				this->rowRowSums[s] += (double)i * i;
+				this->rowColSums[s] += (double)i * j;
+				this->colColSums[s] += (double)j * j;
+			}
+		}
+	}
+}
+
+bool SegmentStatistics::hasStatistics(int statistics) const {
+	return (this->gathered & statistics) == statistics;
+}
+
+int SegmentStatistics::getNumberOfSegments() const {
+	return (int)this->areas.size();
+}
+
+int SegmentStatistics::getRows() const {
+	return this->rows;
+}
+
+int SegmentStatistics::getCols() const {
+	return this->cols;
+}
+
+const vector<int> &SegmentStatistics::getAreas() const {
+	return this->areas;
+}
+
+const vector<int> &SegmentStatistics::getMaskedAreas() const {
+	return this->maskedAreas;
+}
+
+const vector<double> &SegmentStatistics::getColorSums(int channel) const {
+	assert(channel >= 0 && channel < 3 && this->hasStatistics(COLOR_STATISTICS));
+
+	return this->colorSums[channel];
+}
+
+const vector<double> &SegmentStatistics::getHueSums() const {
+	assert(this->hasStatistics(HUE_STATISTICS));
+
+	return this->hueSums;
+}
+
+const vector<double> &SegmentStatistics::getRowSums() const {
+	assert(this->hasStatistics(POSITION_STATISTICS));
+
+	return this->rowSums;
+}
+
+const vector<double> &SegmentStatistics::getColSums() const {
+	assert(this->hasStatistics(POSITION_STATISTICS));
+
+	return this->colSums;
+}
+
+const vector<double> &SegmentStatistics::getRowRowSums() const {
+	assert(this->hasStatistics(POSITION_STATISTICS));
+
+	return this->rowRowSums;
+}
+
+const vector<double> &SegmentStatistics::getRowColSums() const {
+	assert(this->hasStatistics(POSITION_STATISTICS));
+
+	return this->rowColSums;
+}
+
+const vector<double> &SegmentStatistics::getColColSums() const {
+	assert(this->hasStatistics(POSITION_STATISTICS));
+
+	return this->colColSums;
+}
@@ -0,0 +1,99 @@
+/** @file */
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include "DisjointSet.hpp"
+
+using namespace std;
+using namespace cv;
+
+/**
+ * Attributes of the pixels of segments which statistics may be gathered
+ * for, combined as bit flags.
+ */
+enum SegmentStatisticsType { COLOR_STATISTICS = 1, POSITION_STATISTICS = 2, HUE_STATISTICS = 4 };
+
+/**
+ * Per segment sums of pixel attributes of a segmented image, gathered in a
+ * single raster pass. Sums are stored as one array per attribute, indexed
+ * by segment, so attributes of all segments can be read contiguously.
+ * Segment labeling functions are views over it, dividing sums by segment
+ * areas once per segment.
+ *
+ * Sums are taken over the pixels of the mask only, while areas count all
+ * the elements of each segment. Only the sums of the attributes requested
+ * at construction are gathered, and reading the others is an error.
+ */
+class SegmentStatistics {
+private:
+	int rows;
+	int cols;
+	// SegmentStatisticsType flags of the gathered statistics.
+	int gathered;
+	vector<int> areas;
+	vector<int> maskedAreas;
+	vector<double> colorSums[3];
+	vector<double> hueSums;
+	// sums of row and column coordinates, and of their products.
+	vector<double> rowSums;
+	vector<double> colSums;
+	vector<double> rowRowSums;
+	vector<double> rowColSums;
+	vector<double> colColSums;
+
+public:
+	/**
+	 * Gathers the statistics of each segment of an image.
+	 *
+	 * @param segmentation a segmentation of the image, whose pixels are the
+	 * first elements of the forest in row major order.
+	 * @param image the segmented image.
+	 * @param mask mask of the image specifying pixels to take into account.
+	 * @param hue optional hue plane of the image. Hue sums are gathered iff
+	 * it is not empty.
+	 * @param statistics SegmentStatisticsType flags of the color and position
+	 * statistics to gather, areas being always computed.
+	 */
+	SegmentStatistics(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask, const Mat_<float> &hue = Mat_<float>(), int statistics = COLOR_STATISTICS | POSITION_STATISTICS);
+
+	/**
+	 * Returns true iff all the statistics of given SegmentStatisticsType
+	 * flags have been gathered.
+	 */
+	bool hasStatistics(int statistics) const;
+
+	int getNumberOfSegments() const;
+
+	int getRows() const;
+
+	int getCols() const;
+
+	/**
+	 * Returns the number of elements of each segment.
+	 */
+	const vector<int> &getAreas() const;
+
+	/**
+	 * Returns the number of pixels of each segment in the mask, over which
+	 * sums are taken.
+	 */
+	const vector<int> &getMaskedAreas() const;
+
+	/**
+	 * Returns the sum of a color channel over each segment.
+	 */
+	const vector<double> &getColorSums(int channel) const;
+
+	const vector<double> &getHueSums() const;
+
+	const vector<double> &getRowSums() const;
+
+	const vector<double> &getColSums() const;
+
+	const vector<double> &getRowRowSums() const;
+
+	const vector<double> &getRowColSums() const;
+
+	const vector<double> &getColColSums() const;
+};
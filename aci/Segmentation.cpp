@@ -14,101 +14,234 @@ static double euclidDistance(const Mat &m1, const Mat &m2) {
 	return norm(m1 - m2);
 }
 
-static bool compareHueDiff(std::tuple<int,int,double> e1, std::tuple<int,int,double> e2) {
-	return get<2>(e1) < get<2>(e2);
-}
+/**
+ * Pair of segments, given by their positions in hue order, with the
+ * difference of their hues.
+ */
+struct HuePair {
+	double difference;
+	int first;
+	int second;
+};
+
+class HuePairCompare {
+public:
+	bool operator()(const HuePair &pair1, const HuePair &pair2) const {
+		return pair1.difference > pair2.difference;
+	}
+};
 
-void fuseByHue(const Mat_<Vec3f> &image, const Mat_<float> &mask, DisjointSetForest &overSegmentation, DisjointSetForest &segmentation) {
-	segmentation = overSegmentation;
-	vector<VectorXd> averageHues = averageHueLabeling(overSegmentation, image, mask);
-	vector<std::tuple<int,int,double> > edges;
-	edges.reserve((overSegmentation.getNumberOfComponents() - 1) * overSegmentation.getNumberOfComponents() / 2);
+void closestHuePairs(const vector<double> &hues, int nbPairs, vector<pair<int,int> > &pairs) {
+	int nbSegments = (int)hues.size();
+
+	pairs.clear();
+	nbPairs = min(nbPairs, nbSegments * (nbSegments - 1) / 2);
+	pairs.reserve(max(nbPairs, 0));
+
+	// hue is a scalar, so the closest segments to one are its successors in
+	// hue order. A heap holding for each segment its closest successor not
+	// yet paired with it yields all pairs by increasing hue difference,
+	// without listing and sorting all of them.
+	vector<pair<double,int> > sortedHues(nbSegments);
+
+	for (int i = 0; i < nbSegments; i++) {
+		sortedHues[i] = pair<double,int>(hues[i], i);
+	}
+	sort(sortedHues.begin(), sortedHues.end());
+
+	priority_queue<HuePair, vector<HuePair>, HuePairCompare> queue;
+
+	for (int i = 0; i < nbSegments - 1; i++) {
+		HuePair huePair;
+
+		huePair.first = i;
+		huePair.second = i + 1;
+		huePair.difference = sortedHues[i + 1].first - sortedHues[i].first;
+		queue.push(huePair);
+	}
+
+	for (int i = 0; i < nbPairs; i++) {
+		HuePair closest = queue.top();
+		queue.pop();
 
-	for (int i = 1; i < overSegmentation.getNumberOfComponents(); i++) {
-		for (int j = i + 1; j < overSegmentation.getNumberOfComponents(); j++) {
-			edges.push_back(std::tuple<int,int,double>(i,j, abs(averageHues[i](0) - averageHues[j](0))));
+		pairs.push_back(pair<int,int>(sortedHues[closest.first].second, sortedHues[closest.second].second));
+
+		if (closest.second + 1 < nbSegments) {
+			closest.second++;
+			closest.difference = sortedHues[closest.second].first - sortedHues[closest.first].first;
+			queue.push(closest);
 		}
 	}
+}
 
-	sort(edges.begin(), edges.end(), compareHueDiff);
-	vector<int> reverseIndexes(overSegmentation.getNumberOfComponents(), -1);
-	map<int,int> rootIndexes = overSegmentation.getRootIndexes();
+void fuseByHue(ColorPlanes &colorPlanes, const Mat_<float> &mask, DisjointSetForest &overSegmentation, DisjointSetForest &segmentation) {
+	segmentation = overSegmentation;
+	vector<VectorXd> averageHues = averageHueLabeling(overSegmentation, colorPlanes, mask);
+	const vector<int> &reverseIndexes = overSegmentation.getSegmentRoots();
+	int nbSegments = overSegmentation.getNumberOfComponents();
+
+	// fuses the 10% pairs of segments, except the first one, with the
+	// smallest hue difference.
+	if (nbSegments < 3) {
+		return;
+	}
+	int nbFusions = (nbSegments - 1) * (nbSegments - 2) / 2 / 10;
+	vector<double> hues(nbSegments - 1);
+	vector<pair<int,int> > pairs;
 
-	for (map<int,int>::iterator it = rootIndexes.begin(); it != rootIndexes.end(); it++) {
-		reverseIndexes[(*it).second] = (*it).first;
+	for (int i = 1; i < nbSegments; i++) {
+		hues[i - 1] = averageHues[i](0);
 	}
 
-	for (int i = 0; i < (int)edges.size()/10 ; i++) {
-		std::tuple<int,int,double> edge = edges[i];
+	closestHuePairs(hues, nbFusions, pairs);
 
-		segmentation.setUnion(reverseIndexes[get<0>(edge)], reverseIndexes[get<1>(edge)]);
+	for (int i = 0; i < (int)pairs.size(); i++) {
+		segmentation.setUnion(reverseIndexes[pairs[i].first + 1], reverseIndexes[pairs[i].second + 1]);
 	}
 }
 
 void segment(const Mat_<Vec3f> &image, const Mat_<float> &mask, DisjointSetForest &segmentation, int felzenszwalbScale) {
 	assert(felzenszwalbScale >= 0);
-	WeightedGraph graph = gridGraph(image, CONNECTIVITY_4, mask, euclidDistance, false);
+	// every graph built for this image draws from the same arena, released
+	// in one step when the segmentation is done.
+	GraphArena arena;
+	WeightedGraph graph = gridGraph(image, CONNECTIVITY_4, mask, euclidDistance, false, &arena);
 	int minCompSize = countNonZero(mask) / MAX_SEGMENTS;
 	DisjointSetForest overSegmentation = felzenszwalbSegment(felzenszwalbScale, graph, minCompSize, mask, VOLUME);
-	fuseByHue(image, mask, overSegmentation, segmentation);
+	fuseComponentsDownTo(MAX_SEGMENTS, overSegmentation, graph);
+	ColorPlanes colorPlanes(image);
+	fuseByHue(colorPlanes, mask, overSegmentation, segmentation);
 }
 
-static double constOne(const Mat &m1, const Mat &m2) {
-	return 1;
-}
+void segmentScales(const Mat_<Vec3f> &image, const Mat_<float> &mask, const vector<int> &felzenszwalbScales, vector<DisjointSetForest> &segmentations) {
+	GraphArena arena;
+	WeightedGraph graph = gridGraph(image, CONNECTIVITY_4, mask, euclidDistance, false, &arena);
+	int minCompSize = countNonZero(mask) / MAX_SEGMENTS;
+	FelzenszwalbHierarchy hierarchy(graph, mask, VOLUME);
+	ColorPlanes colorPlanes(image);
 
-static bool lexicographicOrder(const Vec3b &v1, const Vec3b &v2) {
-	return 
-		v1[0] < v2 [0] || 
-		(v1[0] == v2[0] &&
-		 (v1[1] < v2[1] ||
-		  (v1[1] == v2[1] && v1[2] < v2[2])));
+	segmentations.clear();
+	segmentations.reserve(felzenszwalbScales.size());
+
+	for (int i = 0; i < (int)felzenszwalbScales.size(); i++) {
+		assert(felzenszwalbScales[i] >= 0);
+		DisjointSetForest overSegmentation = hierarchy.segment(felzenszwalbScales[i], minCompSize);
+		fuseComponentsDownTo(MAX_SEGMENTS, overSegmentation, graph);
+		DisjointSetForest segmentation;
+
+		fuseByHue(colorPlanes, mask, overSegmentation, segmentation);
+		segmentations.push_back(segmentation);
+	}
 }
 
-DisjointSetForest segmentationImageToSegmentation(const Mat_<Vec3b> &segmentationImage, const Mat_<float> &mask) {
-	assert(segmentationImage.rows == mask.rows && segmentationImage.cols == mask.cols);
+/**
+ * Open addressing hash table from 24 bits colors packed into integers to
+ * the first pixel of each color, with linear probing. Manual segmentations
+ * have few distinct colors, so the table stays small and in cache.
+ */
+class ColorIndexTable {
+private:
+	vector<int> keys;
+	vector<int> values;
+	int count;
+
+	static int hash(int key) {
+		return (int)(((unsigned)key * 2654435761U) >> 8);
+	}
 
-	DisjointSetForest segmentation(segmentationImage.rows * segmentationImage.cols + 1);
-	typedef bool (*keyComp)(const Vec3b&, const Vec3b&);
-	std::map<Vec3b,int, keyComp> colorRepresentant(lexicographicOrder);
+	void grow() {
+		vector<int> oldKeys;
+		vector<int> oldValues;
 
-	// fuse pixels of the same color
-	for (int i = 0; i < segmentationImage.rows; i++) {
-		for (int j = 0; j < segmentationImage.cols; j++) {
-			if (mask(i,j) > 0.5) {
-				Vec3b color = segmentationImage(i,j);
-				int linIndex = toRowMajor(segmentationImage.cols, j, i);
-
-				if (colorRepresentant.find(color) == colorRepresentant.end()) {
-					colorRepresentant[color] = linIndex;
-				} else {
-					segmentation.setUnion(colorRepresentant[color], linIndex);
-				}
+		oldKeys.swap(this->keys);
+		oldValues.swap(this->values);
+		this->keys.assign(oldKeys.size() * 2, -1);
+		this->values.resize(oldValues.size() * 2);
+		this->count = 0;
+
+		for (int i = 0; i < (int)oldKeys.size(); i++) {
+			if (oldKeys[i] >= 0) {
+				this->findOrInsert(oldKeys[i], oldValues[i]);
+			}
+		}
+	}
+
+public:
+	ColorIndexTable()
+		: keys(1024, -1), values(1024), count(0)
+	{
+
+	}
+
+	/**
+	 * Returns the value associated to a key, associating it the given value
+	 * first if it is not in the table yet.
+	 */
+	int findOrInsert(int key, int value) {
+		int capacityMask = (int)this->keys.size() - 1;
+		int slot = hash(key) & capacityMask;
+
+		while (this->keys[slot] >= 0) {
+			if (this->keys[slot] == key) {
+				return this->values[slot];
 			}
+			slot = (slot + 1) & capacityMask;
+		}
+
+		this->keys[slot] = key;
+		this->values[slot] = value;
+		this->count++;
+
+		if (2 * this->count > (int)this->keys.size()) {
+			this->grow();
 		}
+
+		return value;
 	}
+};
+
+DisjointSetForest segmentationImageToSegmentation(const Mat_<Vec3b> &segmentationImage, const Mat_<float> &mask) {
+	assert(segmentationImage.rows == mask.rows && segmentationImage.cols == mask.cols);
+	int nbPixels = segmentationImage.rows * segmentationImage.cols;
+	int background = nbPixels;
+
+	// a single raster pass links each foreground pixel to the first pixel
+	// of its color, and each background pixel to the background element.
+	// Roots being known upfront, the forest is built directly instead of
+	// through unions.
+	vector<int> roots(nbPixels + 1);
+	vector<int> componentSizes(nbPixels + 1, 0);
+	ColorIndexTable colorRepresentant;
 
-	// fuse small components
-	segmentation.fuseSmallComponents(
-		gridGraph(
-			segmentationImage, 
-			CONNECTIVITY_4,
-			mask, 
-			constOne, 
-			false), 
-		25, 
-		mask);
+	roots[background] = background;
+	componentSizes[background] = 1;
 
+	for (int i = 0; i < segmentationImage.rows; i++) {
+		const Vec3b *colors = segmentationImage[i];
+		const float *maskRow = mask[i];
+
+		for (int j = 0; j < segmentationImage.cols; j++) {
+			int linIndex = toRowMajor(segmentationImage.cols, j, i);
+			int root;
 
-	// fuse background pixels into one segment
-	for (int i = 0; i < segmentation.getNumberOfElements() - 1; i++) {
-		pair<int,int> coords = fromRowMajor(mask.cols, i);
+			if (maskRow[j] > 0.5) {
+				int key = colors[j][0] | (colors[j][1] << 8) | (colors[j][2] << 16);
 
-		if (mask(coords.first, coords.second) < 0.5) {
-			segmentation.setUnion(segmentationImage.rows * segmentationImage.cols, i);
+				root = colorRepresentant.findOrInsert(key, linIndex);
+			} else {
+				root = background;
+			}
+			roots[linIndex] = root;
+			componentSizes[root]++;
 		}
 	}
 
+	DisjointSetForest segmentation(nbPixels + 1, &roots[0], &componentSizes[0]);
+
+	// fuse small components. The background root is not a pixel, so the
+	// background segment is left out.
+	segmentation.fuseSmallComponents(mask, 25);
+
 	return segmentation;
 }
 
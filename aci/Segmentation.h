@@ -15,6 +15,17 @@
 using namespace std;
 using namespace cv;
 
+/**
+ * Finds the pairs of segments with the smallest hue difference, in
+ * O((n + p) log n) time for n segments and p pairs.
+ *
+ * @param hues average hue of each segment.
+ * @param nbPairs number of pairs to find, at most n(n - 1)/2 are found.
+ * @param pairs output pairs of segment indexes by increasing hue
+ * difference. The order of pairs with equal differences is unspecified.
+ */
+void closestHuePairs(const vector<double> &hues, int nbPairs, vector<pair<int,int> > &pairs);
+
 /**
  * Segmentation method which compute a graph from an animation character image,
  * without background - the background pixels to ignore are specified as 0 in
@@ -28,6 +39,17 @@ using namespace cv;
  */
 void segment(const Mat_<Vec3f> &image, const Mat_<float> &mask, DisjointSetForest &segmentation, int felzenszwalbScale = 1000);
 
+/**
+ * Segments an image as segment does for several Felzenszwalb scales, building
+ * and sorting the image graph only once. Use it to sweep the scale parameter.
+ *
+ * @param image image to segment.
+ * @param mask mask of the image specifying pixels to take into account.
+ * @param felzenszwalbScales scales to segment the image at.
+ * @param segmentations output segmentation of the image at each scale.
+ */
+void segmentScales(const Mat_<Vec3f> &image, const Mat_<float> &mask, const vector<int> &felzenszwalbScales, vector<DisjointSetForest> &segmentations);
+
 /**
  * Converts a segmentation image, where each color corresponds to a segment,
  * into a corresponding disjoint set forest data structure representing
@@ -1,64 +1,329 @@
 #include "SegmentationGraph.hpp"
 
-WeightedGraph segmentationGraph(DisjointSetForest &segmentation, const WeightedGraph &grid) {
-	int numberOfComponents = segmentation.getNumberOfComponents();
-	WeightedGraph graph(numberOfComponents);
-	vector<vector<bool> > adjMatrix(numberOfComponents, vector<bool>(numberOfComponents, false));
-	map<int,int> rootIndexes = segmentation.getRootIndexes();
-	//Mat_<int> borderLengths = computeBorderLengths(segmentation, grid);
+/**
+ * Pair of neighboring elements in different segments, with the segment
+ * indexes packed in a single key, the smallest in the high bits, so
+ * sorting pairs groups them by edge of the region adjacency graph.
+ */
+struct BoundaryPair {
+	unsigned long long segments;
+	float contrast;
+};
+
+static bool boundaryPairOrder(const BoundaryPair &pair1, const BoundaryPair &pair2) {
+	return pair1.segments < pair2.segments;
+}
+
+static void addBoundaryPair(vector<BoundaryPair> &pairs, int segment1, int segment2, float contrast) {
+	BoundaryPair pair;
+
+	if (segment1 > segment2) {
+		swap(segment1, segment2);
+	}
+	pair.segments = ((unsigned long long)segment1 << 32) | (unsigned long long)segment2;
+	pair.contrast = contrast;
+	pairs.push_back(pair);
+}
+
+/**
+ * Sorts and reduces boundary pairs into the edges of a region adjacency
+ * graph.
+ */
+static RegionAdjacencyGraph reduceBoundaryPairs(int numberOfSegments, vector<BoundaryPair> &pairs) {
+	sort(pairs.begin(), pairs.end(), boundaryPairOrder);
+
+	// reduces runs of pairs with the same segments into edges.
+	vector<int> sources;
+	vector<int> destinations;
+	vector<int> lengths;
+	vector<float> contrastSums;
+	vector<int> degrees(numberOfSegments, 0);
+
+	for (int i = 0; i < (int)pairs.size(); i++) {
+		if (i == 0 || pairs[i].segments != pairs[i - 1].segments) {
+			int source = (int)(pairs[i].segments >> 32);
+			int destination = (int)(pairs[i].segments & 0xFFFFFFFFULL);
+
+			sources.push_back(source);
+			destinations.push_back(destination);
+			lengths.push_back(0);
+			contrastSums.push_back(0);
+			degrees[source]++;
+			degrees[destination]++;
+		}
+		lengths.back()++;
+		contrastSums.back() += pairs[i].contrast;
+	}
+
+	RegionAdjacencyGraph rag;
+	int numberOfEntries = 2 * (int)sources.size();
+
+	rag.offsets.resize(numberOfSegments + 1);
+	rag.offsets[0] = 0;
+
+	for (int s = 0; s < numberOfSegments; s++) {
+		rag.offsets[s + 1] = rag.offsets[s] + degrees[s];
+	}
+
+	rag.neighbors.resize(numberOfEntries);
+	rag.borderLengths.resize(numberOfEntries);
+	rag.contrasts.resize(numberOfEntries);
+
+	// edges being sorted by source then destination, each list gets its
+	// smaller neighbors then its larger ones in increasing order.
+	vector<int> positions(rag.offsets.begin(), rag.offsets.end() - 1);
+
+	for (int e = 0; e < (int)sources.size(); e++) {
+		float contrast = contrastSums[e] / (float)lengths[e];
+		int sourcePosition = positions[sources[e]]++;
+		int destinationPosition = positions[destinations[e]]++;
+
+		rag.neighbors[sourcePosition] = destinations[e];
+		rag.borderLengths[sourcePosition] = lengths[e];
+		rag.contrasts[sourcePosition] = contrast;
+		rag.neighbors[destinationPosition] = sources[e];
+		rag.borderLengths[destinationPosition] = lengths[e];
+		rag.contrasts[destinationPosition] = contrast;
+	}
+
+	return rag;
+}
+
+int RegionAdjacencyGraph::numberOfVertices() const {
+	return (int)this->offsets.size() - 1;
+}
+
+int RegionAdjacencyGraph::numberOfEdges() const {
+	return (int)this->neighbors.size() / 2;
+}
+
+WeightedGraph RegionAdjacencyGraph::toWeightedGraph(GraphArena *arena) const {
+	WeightedGraph graph(this->numberOfVertices(), -1, arena);
+
+	for (int s = 0; s < this->numberOfVertices(); s++) {
+		for (int k = this->offsets[s]; k < this->offsets[s + 1]; k++) {
+			if (this->neighbors[k] > s) {
+				graph.addEdge(s, this->neighbors[k], (float)this->borderLengths[k]);
+			}
+		}
+	}
+
+	return graph;
+}
+
+RegionAdjacencyGraph regionAdjacencyGraph(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask) {
+	assert(image.rows == mask.rows && image.cols == mask.cols);
+	assert(segmentation.getNumberOfElements() >= image.rows * image.cols);
+	const vector<int> &segmentIndexes = segmentation.getSegmentIndexes();
+	vector<BoundaryPair> pairs;
+
+	for (int i = 0; i < image.rows; i++) {
+		for (int j = 0; j < image.cols; j++) {
+			if (mask(i,j) < 0.5) {
+				continue;
+			}
+			int pixel = toRowMajor(image.cols, j, i);
+			int segment = segmentIndexes[pixel];
+
+			if (j + 1 < image.cols && mask(i,j + 1) >= 0.5 && segmentIndexes[pixel + 1] != segment) {
+				addBoundaryPair(pairs, segment, segmentIndexes[pixel + 1], (float)norm(image(i,j) - image(i,j + 1)));
+			}
+			if (i + 1 < image.rows && mask(i + 1,j) >= 0.5 && segmentIndexes[pixel + image.cols] != segment) {
+				addBoundaryPair(pairs, segment, segmentIndexes[pixel + image.cols], (float)norm(image(i,j) - image(i + 1,j)));
+			}
+		}
+	}
+
+	return reduceBoundaryPairs(segmentation.getNumberOfComponents(), pairs);
+}
+
+RegionAdjacencyGraph regionAdjacencyGraph(DisjointSetForest &segmentation, const WeightedGraph &grid) {
+	const vector<int> &segmentIndexes = segmentation.getSegmentIndexes();
+	vector<BoundaryPair> pairs;
 
-	// for each pair of neighboring pixels
 	for (int i = 0; i < (int)grid.getEdges().size(); i++) {
 		Edge edge = grid.getEdges()[i];
-		int srcRoot = rootIndexes[segmentation.find(edge.source)];
-		int dstRoot = rootIndexes[segmentation.find(edge.destination)];
-
-		// if they are not in the same segment and there isn't
-		// already an edge between them, add one.
-		if (srcRoot != dstRoot && 
-			!adjMatrix[srcRoot][dstRoot] &&
-			!adjMatrix[dstRoot][srcRoot]) {
-				adjMatrix[srcRoot][dstRoot] = true;
-				adjMatrix[dstRoot][srcRoot] = true;
-				graph.addEdge(srcRoot, dstRoot, 1/*(float)borderLengths(srcRoot, dstRoot)*/);
+		int src = segmentIndexes[edge.source];
+		int dst = segmentIndexes[edge.destination];
+
+		if (src != dst) {
+			addBoundaryPair(pairs, src, dst, edge.weight);
 		}
 	}
 
-	return graph;
+	return reduceBoundaryPairs(segmentation.getNumberOfComponents(), pairs);
+}
+
+WeightedGraph segmentationGraph(DisjointSetForest &segmentation, const WeightedGraph &grid, GraphArena *arena) {
+	return regionAdjacencyGraph(segmentation, grid).toWeightedGraph(arena);
 }
 
-Mat_<int> computeBorderLengths(DisjointSetForest &segmentation, WeightedGraph &gridGraph) {
-	Mat_<int> borderLengths = Mat_<int>::zeros(segmentation.getNumberOfComponents(), segmentation.getNumberOfComponents());
-	map<int,int> rootIndexes = segmentation.getRootIndexes();
+DynamicRegionAdjacencyGraph::DynamicRegionAdjacencyGraph(DisjointSetForest &segmentation, const RegionAdjacencyGraph &rag, const Mat_<Vec3f> &image)
+	: segmentation(segmentation),
+	roots(segmentation.getSegmentRoots()),
+	borders(rag.numberOfVertices()),
+	borderPositions(rag.numberOfVertices()),
+	areas(rag.numberOfVertices()),
+	colorSums(rag.numberOfVertices(), Vec3d(0,0,0)),
+	positionSums(rag.numberOfVertices(), Vec2d(0,0)),
+	alive(rag.numberOfVertices(), 1),
+	numberOfRegions(rag.numberOfVertices())
+{
+	assert(segmentation.getNumberOfComponents() == rag.numberOfVertices());
 
-	for (int i = 0; i < (int)gridGraph.getEdges().size(); i++) {
-		Edge edge = gridGraph.getEdges()[i];
-		int srcRoot = segmentation.find(edge.source);
-		int dstRoot = segmentation.find(edge.destination);
+	for (int r = 0; r < this->numberOfRegions; r++) {
+		this->areas[r] = segmentation.getComponentSize(this->roots[r]);
+		this->borders[r].reserve(rag.offsets[r + 1] - rag.offsets[r]);
+		this->borderPositions[r].rehash(rag.offsets[r + 1] - rag.offsets[r]);
 
-		if (srcRoot != dstRoot) {
-			int src = rootIndexes[srcRoot];
-			int dst = rootIndexes[dstRoot];
+		for (int k = rag.offsets[r]; k < rag.offsets[r + 1]; k++) {
+			RegionBorder border;
 
-			borderLengths(src, dst) += 1;
-			borderLengths(dst, src) += 1;
+			border.region = rag.neighbors[k];
+			border.length = rag.borderLengths[k];
+			border.contrastSum = rag.contrasts[k] * (float)rag.borderLengths[k];
+			this->borderPositions[r][border.region] = (int)this->borders[r].size();
+			this->borders[r].push_back(border);
 		}
 	}
 
-	return borderLengths;
+	if (!image.empty()) {
+		assert(segmentation.getNumberOfElements() >= image.rows * image.cols);
+		const vector<int> &segmentIndexes = segmentation.getSegmentIndexes();
+
+		for (int i = 0; i < image.rows; i++) {
+			for (int j = 0; j < image.cols; j++) {
+				int region = segmentIndexes[toRowMajor(image.cols, j, i)];
+
+				this->colorSums[region] += Vec3d(image(i,j)[0], image(i,j)[1], image(i,j)[2]);
+				this->positionSums[region] += Vec2d(i, j);
+			}
+		}
+	}
+}
+
+void DynamicRegionAdjacencyGraph::addBorder(int region, const RegionBorder &border) {
+	std::unordered_map<int,int>::iterator position = this->borderPositions[region].find(border.region);
+
+	if (position != this->borderPositions[region].end()) {
+		RegionBorder &existing = this->borders[region][position->second];
+
+		existing.length += border.length;
+		existing.contrastSum += border.contrastSum;
+	} else {
+		this->borderPositions[region][border.region] = (int)this->borders[region].size();
+		this->borders[region].push_back(border);
+	}
+}
+
+void DynamicRegionAdjacencyGraph::removeBorder(int region, int neighbor) {
+	vector<RegionBorder> &regionBorders = this->borders[region];
+	std::unordered_map<int,int>::iterator position = this->borderPositions[region].find(neighbor);
+	assert(position != this->borderPositions[region].end());
+	int removed = position->second;
+
+	this->borderPositions[region].erase(position);
+
+	if (removed != (int)regionBorders.size() - 1) {
+		regionBorders[removed] = regionBorders.back();
+		this->borderPositions[region][regionBorders[removed].region] = removed;
+	}
+	regionBorders.pop_back();
+}
+
+int DynamicRegionAdjacencyGraph::merge(int region1, int region2) {
+	assert(this->isAlive(region1) && this->isAlive(region2) && region1 != region2);
+
+	// the region with the most neighbors is kept, so only the borders of
+	// the smallest one are moved.
+	int kept = region1;
+	int absorbed = region2;
+
+	if (this->borders[kept].size() < this->borders[absorbed].size()) {
+		swap(kept, absorbed);
+	}
+
+	vector<RegionBorder> absorbedBorders;
+	absorbedBorders.swap(this->borders[absorbed]);
+	std::unordered_map<int,int>().swap(this->borderPositions[absorbed]);
+
+	this->removeBorder(kept, absorbed);
+
+	// neighbors of the absorbed region now border the kept one instead.
+	for (int i = 0; i < (int)absorbedBorders.size(); i++) {
+		RegionBorder border = absorbedBorders[i];
+		int neighbor = border.region;
+
+		if (neighbor == kept) {
+			continue;
+		}
+		this->addBorder(kept, border);
+		this->removeBorder(neighbor, absorbed);
+		border.region = kept;
+		this->addBorder(neighbor, border);
+	}
+
+	this->areas[kept] += this->areas[absorbed];
+	this->colorSums[kept] += this->colorSums[absorbed];
+	this->positionSums[kept] += this->positionSums[absorbed];
+	this->alive[absorbed] = 0;
+	this->numberOfRegions--;
+	this->roots[kept] = this->segmentation.setUnion(this->roots[kept], this->roots[absorbed]);
+
+	return kept;
+}
+
+const vector<RegionBorder> &DynamicRegionAdjacencyGraph::getBorders(int region) const {
+	assert(this->isAlive(region));
+
+	return this->borders[region];
+}
+
+int DynamicRegionAdjacencyGraph::getBorderLength(int region1, int region2) const {
+	std::unordered_map<int,int>::const_iterator position = this->borderPositions[region1].find(region2);
+
+	return position != this->borderPositions[region1].end() ? this->borders[region1][position->second].length : 0;
+}
+
+int DynamicRegionAdjacencyGraph::getArea(int region) const {
+	return this->areas[region];
+}
+
+const Vec3d &DynamicRegionAdjacencyGraph::getColorSum(int region) const {
+	return this->colorSums[region];
+}
+
+const Vec2d &DynamicRegionAdjacencyGraph::getPositionSum(int region) const {
+	return this->positionSums[region];
+}
+
+bool DynamicRegionAdjacencyGraph::isAlive(int region) const {
+	return this->alive[region] != 0;
+}
+
+int DynamicRegionAdjacencyGraph::getNumberOfRegions() const {
+	return this->numberOfRegions;
+}
+
+int DynamicRegionAdjacencyGraph::getRegionCapacity() const {
+	return (int)this->alive.size();
 }
 
 vector<Vec<float,2> > segmentCenters(const Mat_<Vec<uchar,3> > &image, DisjointSetForest &segmentation) {
 	int numberOfComponents = segmentation.getNumberOfComponents();
 	vector<Vec<float, 2> > centers(numberOfComponents, Vec<int,2>(0,0));
-	map<int,int> rootIndexes = segmentation.getRootIndexes();
+	const vector<int> &segmentOffsets = segmentation.getSegmentOffsets();
+	const vector<int> &segmentElements = segmentation.getSegmentElements();
 
-	for (int i = 0; i < image.rows; i++) {
-		for (int j = 0; j < image.cols; j++) {
-			int root = segmentation.find(toRowMajor(image.cols, j, i));
-			int rootIndex = rootIndexes[root];
+	#pragma omp parallel for if(segmentation.getNumberOfElements() > PARALLEL_SEGMENTS_THRESHOLD)
+	for (int s = 0; s < numberOfComponents; s++) {
+		float segmentSize = (float)(segmentOffsets[s + 1] - segmentOffsets[s]);
+
+		for (int k = segmentOffsets[s]; k < segmentOffsets[s + 1]; k++) {
+			int i = segmentElements[k] / image.cols;
+			int j = segmentElements[k] % image.cols;
 
-			centers[rootIndex] += Vec<float,2>((float)i,(float)j)/((float)segmentation.getComponentSize(root));
+			centers[s] += Vec<float,2>((float)i,(float)j)/segmentSize;
 		}
 	}
 
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 #include <iostream>
 #include <opencv2/opencv.hpp>
 
@@ -12,28 +13,198 @@ using namespace cv;
 using namespace std;
 
 /**
- * Computes the border length between each pair of segments in the
- * segmentation.
+ * Region adjacency graph of a segmentation in compressed sparse row form,
+ * taking O(number of edges) memory. The neighbors of segment s are
+ * neighbors[offsets[s]] to neighbors[offsets[s + 1] - 1], by increasing
+ * segment index, every edge being represented in the lists of both its
+ * segments. Border lengths and contrasts are given for each entry of
+ * neighbors.
+ */
+struct RegionAdjacencyGraph {
+	vector<int> offsets;
+	vector<int> neighbors;
+	// number of pairs of neighboring pixels on the border between segments.
+	vector<int> borderLengths;
+	// mean color distance between the pixels of these pairs.
+	vector<float> contrasts;
+
+	int numberOfVertices() const;
+
+	/**
+	 * Returns the number of edges, each edge being counted once.
+	 */
+	int numberOfEdges() const;
+
+	/**
+	 * Converts the region adjacency graph to a weighted graph where every
+	 * edge is represented in only one adjacency list, weighted by border
+	 * length.
+	 *
+	 * @param arena optional arena for the adjacency lists of the graph.
+	 */
+	WeightedGraph toWeightedGraph(GraphArena *arena = NULL) const;
+};
+
+/**
+ * Computes the region adjacency graph of an image segmentation in one
+ * pass over the image, for the 4-connectivity of pixels in the mask.
+ * Pairs of neighboring pixels on segment borders are sorted by segment
+ * pair and reduced into edges, so it runs in O(n + m log m) time where m
+ * is the number of pixels on segment borders.
  *
- * @param segmentation a segmentation of the image
- * @param gridGraph the grid graph of the image
- * @return an n by n matrix, where n is the number of segments, and the (i,j) entry
- * contains the border length between segments i and j.
+ * @param segmentation a segmentation of the image, whose pixels are the
+ * first elements of the forest in row major order.
+ * @param image the segmented image, used to compute border contrasts.
+ * @param mask mask of the image specifying pixels to take into account.
+ * @return the region adjacency graph of the segmentation.
+ */
+RegionAdjacencyGraph regionAdjacencyGraph(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask);
+
+/**
+ * Computes the region adjacency graph of a segmentation from the edges of
+ * a graph on its elements, typically a grid graph. Edges are counted
+ * as pairs of neighboring pixels for border lengths, and their weights are
+ * averaged as border contrasts.
+ *
+ * @param segmentation a segmentation of the graph's vertices.
+ * @param grid graph indicating neighborhoods between elements.
+ * @return the region adjacency graph of the segmentation.
+ */
+RegionAdjacencyGraph regionAdjacencyGraph(DisjointSetForest &segmentation, const WeightedGraph &grid);
+
+/**
+ * Border between a region of a dynamic region adjacency graph and one of
+ * its neighbors.
  */
-Mat_<int> computeBorderLengths(DisjointSetForest &segmentation, WeightedGraph &gridGraph);
+struct RegionBorder {
+	int region;
+	// number of pairs of neighboring pixels on the border.
+	int length;
+	// sum of the color distances between the pixels of these pairs.
+	float contrastSum;
+};
+
+/**
+ * Region adjacency graph which supports merging adjacent regions, keeping
+ * neighbor lists, border lengths and region statistics (area, color and
+ * position sums) up to date without going back to pixels. Merge based
+ * post-processing can therefore run at region granularity.
+ *
+ * Regions are numbered like the segments of the segmentation it is built
+ * from, and the region resulting from a merge takes the index of one of
+ * the merged regions, the other one becoming dead. The segmentation is
+ * kept in sync with merges.
+ */
+class DynamicRegionAdjacencyGraph {
+private:
+	DisjointSetForest &segmentation;
+	// root in the segmentation of each region.
+	vector<int> roots;
+	// borders of each region, in no particular order.
+	vector<vector<RegionBorder> > borders;
+	// position of the border with each neighbor in the borders of each
+	// region, so borders are found, added and removed in constant time.
+	vector<std::unordered_map<int,int> > borderPositions;
+	vector<int> areas;
+	vector<Vec3d> colorSums;
+	vector<Vec2d> positionSums;
+	vector<char> alive;
+	int numberOfRegions;
+
+	// merges modify the segmentation, which cannot be shared.
+	DynamicRegionAdjacencyGraph(const DynamicRegionAdjacencyGraph &graph);
+	DynamicRegionAdjacencyGraph &operator=(const DynamicRegionAdjacencyGraph &graph);
+
+	/**
+	 * Adds a border to the borders of a region, adding it to an existing
+	 * border with the same neighbor if any.
+	 */
+	void addBorder(int region, const RegionBorder &border);
+
+	/**
+	 * Removes the border with a neighbor from the borders of a region, by
+	 * moving the last border in its place.
+	 */
+	void removeBorder(int region, int neighbor);
+
+public:
+	/**
+	 * Initializes the dynamic region adjacency graph of a segmentation.
+	 * Region statistics are computed in one pass over the image.
+	 *
+	 * @param segmentation segmentation to merge regions of, which must
+	 * outlive the graph.
+	 * @param rag region adjacency graph of the segmentation.
+	 * @param image the segmented image, whose pixels are the first elements
+	 * of the segmentation in row major order. If empty, only areas are
+	 * computed and color and position sums are 0.
+	 */
+	DynamicRegionAdjacencyGraph(DisjointSetForest &segmentation, const RegionAdjacencyGraph &rag, const Mat_<Vec3f> &image = Mat_<Vec3f>());
+
+	/**
+	 * Merges 2 adjacent regions in expected time linear in the smallest of
+	 * their degrees: only the borders of the region which disappears are
+	 * moved, each with a constant number of hash table operations in the
+	 * border lists of the kept region and of the neighbor. Also fuses their
+	 * segments.
+	 *
+	 * @param region1 a living region.
+	 * @param region2 a living region adjacent to region1.
+	 * @return the index of the merged region, either region1 or region2.
+	 */
+	int merge(int region1, int region2);
+
+	/**
+	 * Returns the borders of a living region, in no particular order.
+	 */
+	const vector<RegionBorder> &getBorders(int region) const;
+
+	/**
+	 * Returns the length of the border between 2 regions, 0 if they are not
+	 * adjacent.
+	 */
+	int getBorderLength(int region1, int region2) const;
+
+	int getArea(int region) const;
+
+	const Vec3d &getColorSum(int region) const;
+
+	/**
+	 * Returns the sum of the (row, column) positions of the pixels of a region.
+	 */
+	const Vec2d &getPositionSum(int region) const;
+
+	/**
+	 * Returns false iff a region has been merged into another one.
+	 */
+	bool isAlive(int region) const;
+
+	/**
+	 * Returns the number of living regions.
+	 */
+	int getNumberOfRegions() const;
+
+	/**
+	 * Returns the number of regions the graph was built with, including
+	 * dead ones.
+	 */
+	int getRegionCapacity() const;
+};
 
 /**
  * Computes the segmentation graph of an image segmentation, where
  * vertices are segments and there is an edge between two segments
  * iff these segments are connected in a 4-connexity sense. Every edge
- * is represented in only one adjacency list.
+ * is represented in only one adjacency list, and weighted by the length
+ * of the border between its segments.
  *
  * @param image the segmented image
  * @param segmentation a segmentation of the image
  * @param grid grid graph of the image
+ * @param arena optional arena for the adjacency lists of the segmentation graph.
  * @return the segmentation graph of this image.
  */
-WeightedGraph segmentationGraph(DisjointSetForest &segmentation, const WeightedGraph &grid);
+WeightedGraph segmentationGraph(DisjointSetForest &segmentation, const WeightedGraph &grid, GraphArena *arena = NULL);
 
 /**
  * Computes the center of gravity of each segment in an image.
@@ -0,0 +1,210 @@
+#include "SegmentationGraphTest.h"
+
+#define TEST_IMAGE_ROWS 12
+#define TEST_IMAGE_COLS 15
+
+/**
+ * Generates a random image with few distinct colors, a mask whose top left
+ * corner is background, and a random over segmentation of its pixels.
+ */
+static DisjointSetForest randomSegmentedImage(Mat_<Vec3f> &image, Mat_<float> &mask) {
+	image = Mat_<Vec3f>(TEST_IMAGE_ROWS, TEST_IMAGE_COLS);
+	mask = Mat_<float>(TEST_IMAGE_ROWS, TEST_IMAGE_COLS);
+	DisjointSetForest segmentation(TEST_IMAGE_ROWS * TEST_IMAGE_COLS);
+
+	for (int i = 0; i < image.rows; i++) {
+		for (int j = 0; j < image.cols; j++) {
+			for (int c = 0; c < 3; c++) {
+				image(i,j)[c] = (float)(rand() % 4) * 10;
+			}
+			mask(i,j) = i < 3 && j < 4 ? 0.f : 1.f;
+
+			int pixel = toRowMajor(image.cols, j, i);
+
+			if (j + 1 < image.cols && rand() % 2 == 0) {
+				segmentation.setUnion(pixel, pixel + 1);
+			}
+			if (i + 1 < image.rows && rand() % 2 == 0) {
+				segmentation.setUnion(pixel, pixel + image.cols);
+			}
+		}
+	}
+
+	return segmentation;
+}
+
+/**
+ * Builds the 4-connected grid graph of the pixels of the mask, each edge
+ * stored once and weighted by the euclidean distance between colors.
+ */
+static WeightedGraph maskGridGraph(const Mat_<Vec3f> &image, const Mat_<float> &mask) {
+	WeightedGraph grid(image.rows * image.cols, 2);
+
+	for (int i = 0; i < image.rows; i++) {
+		for (int j = 0; j < image.cols; j++) {
+			if (mask(i,j) < 0.5) {
+				continue;
+			}
+			if (j + 1 < image.cols && mask(i,j + 1) >= 0.5) {
+				grid.addEdge(toRowMajor(image.cols, j, i), toRowMajor(image.cols, j + 1, i), (float)norm(image(i,j) - image(i,j + 1)));
+			}
+			if (i + 1 < image.rows && mask(i + 1,j) >= 0.5) {
+				grid.addEdge(toRowMajor(image.cols, j, i), toRowMajor(image.cols, j, i + 1), (float)norm(image(i,j) - image(i + 1,j)));
+			}
+		}
+	}
+
+	return grid;
+}
+
+/**
+ * Checks a region adjacency graph against its border lengths and contrast
+ * sums by pair of segments, gathered pixel by pixel.
+ */
+static void checkRegionAdjacencyGraph(DisjointSetForest &segmentation, const Mat_<Vec3f> &image, const Mat_<float> &mask, const RegionAdjacencyGraph &rag) {
+	const vector<int> &segmentIndexes = segmentation.getSegmentIndexes();
+	map<pair<int,int>, pair<int,double> > borders;
+
+	for (int i = 0; i < image.rows; i++) {
+		for (int j = 0; j < image.cols; j++) {
+			int neighbors[2][2] = {{i, j + 1}, {i + 1, j}};
+
+			for (int n = 0; n < 2; n++) {
+				int ni = neighbors[n][0];
+				int nj = neighbors[n][1];
+
+				if (ni >= image.rows || nj >= image.cols || mask(i,j) < 0.5 || mask(ni,nj) < 0.5) {
+					continue;
+				}
+				int s1 = segmentIndexes[toRowMajor(image.cols, j, i)];
+				int s2 = segmentIndexes[toRowMajor(image.cols, nj, ni)];
+
+				if (s1 != s2) {
+					pair<int,double> &border = borders[pair<int,int>(min(s1, s2), max(s1, s2))];
+
+					border.first++;
+					border.second += norm(image(i,j) - image(ni,nj));
+				}
+			}
+		}
+	}
+
+	assert(rag.numberOfVertices() == segmentation.getNumberOfComponents());
+	assert(rag.numberOfEdges() == (int)borders.size());
+
+	for (int s = 0; s < rag.numberOfVertices(); s++) {
+		for (int k = rag.offsets[s]; k < rag.offsets[s + 1]; k++) {
+			int neighbor = rag.neighbors[k];
+			pair<int,double> border = borders[pair<int,int>(min(s, neighbor), max(s, neighbor))];
+
+			assert(k == rag.offsets[s] || rag.neighbors[k - 1] < neighbor);
+			assert(rag.borderLengths[k] == border.first);
+			assert(fabs(rag.contrasts[k] - border.second / border.first) < 1e-3);
+		}
+	}
+}
+
+/**
+ * Checks both region adjacency graph builders against borders gathered
+ * pixel by pixel.
+ */
+static void testRegionAdjacencyGraph() {
+	for (int t = 0; t < 20; t++) {
+		Mat_<Vec3f> image;
+		Mat_<float> mask;
+		DisjointSetForest segmentation = randomSegmentedImage(image, mask);
+
+		checkRegionAdjacencyGraph(segmentation, image, mask, regionAdjacencyGraph(segmentation, image, mask));
+		checkRegionAdjacencyGraph(segmentation, image, mask, regionAdjacencyGraph(segmentation, maskGridGraph(image, mask)));
+	}
+}
+
+/**
+ * Checks the dynamic region adjacency graph after each of a sequence of
+ * random merges against the region adjacency graph and statistics of the
+ * updated segmentation, computed from scratch.
+ */
+static void testDynamicRegionAdjacencyGraph() {
+	for (int t = 0; t < 20; t++) {
+		Mat_<Vec3f> image;
+		Mat_<float> mask;
+		DisjointSetForest segmentation = randomSegmentedImage(image, mask);
+		Mat_<float> fullMask(image.rows, image.cols, 1.f);
+		vector<int> initialRoots = segmentation.getSegmentRoots();
+		DynamicRegionAdjacencyGraph dynamicRag(segmentation, regionAdjacencyGraph(segmentation, image, mask), image);
+
+		while (dynamicRag.getNumberOfRegions() > 1) {
+			int region = rand() % dynamicRag.getRegionCapacity();
+
+			if (!dynamicRag.isAlive(region)) {
+				continue;
+			}
+			const vector<RegionBorder> &borders = dynamicRag.getBorders(region);
+
+			if (borders.empty()) {
+				// only background regions are left without neighbors.
+				bool neighbors = false;
+
+				for (int r = 0; r < dynamicRag.getRegionCapacity() && !neighbors; r++) {
+					neighbors = dynamicRag.isAlive(r) && !dynamicRag.getBorders(r).empty();
+				}
+				if (!neighbors) {
+					break;
+				}
+				continue;
+			}
+			dynamicRag.merge(region, borders[rand() % borders.size()].region);
+
+			RegionAdjacencyGraph rag = regionAdjacencyGraph(segmentation, image, mask);
+			SegmentStatistics statistics(segmentation, image, fullMask);
+			const vector<int> &segmentIndexes = segmentation.getSegmentIndexes();
+			// region of each segment of the updated segmentation.
+			vector<int> regions(segmentation.getNumberOfComponents(), -1);
+
+			assert(dynamicRag.getNumberOfRegions() == segmentation.getNumberOfComponents());
+
+			for (int r = 0; r < dynamicRag.getRegionCapacity(); r++) {
+				if (dynamicRag.isAlive(r)) {
+					int segment = segmentIndexes[initialRoots[r]];
+
+					assert(regions[segment] < 0);
+					regions[segment] = r;
+				}
+			}
+
+			for (int s = 0; s < rag.numberOfVertices(); s++) {
+				int r = regions[s];
+				const vector<RegionBorder> &regionBorders = dynamicRag.getBorders(r);
+
+				assert((int)regionBorders.size() == rag.offsets[s + 1] - rag.offsets[s]);
+
+				for (int k = rag.offsets[s]; k < rag.offsets[s + 1]; k++) {
+					int neighbor = regions[rag.neighbors[k]];
+					int b = 0;
+
+					while (b < (int)regionBorders.size() && regionBorders[b].region != neighbor) {
+						b++;
+					}
+					assert(b < (int)regionBorders.size());
+					assert(regionBorders[b].length == rag.borderLengths[k]);
+					assert(fabs(regionBorders[b].contrastSum - rag.contrasts[k] * rag.borderLengths[k]) < 1e-2);
+					assert(dynamicRag.getBorderLength(r, neighbor) == rag.borderLengths[k]);
+					assert(dynamicRag.getBorderLength(neighbor, r) == rag.borderLengths[k]);
+				}
+
+				assert(dynamicRag.getArea(r) == statistics.getAreas()[s]);
+
+				for (int c = 0; c < 3; c++) {
+					assert(dynamicRag.getColorSum(r)[c] == statistics.getColorSums(c)[s]);
+				}
+				assert(dynamicRag.getPositionSum(r)[0] == statistics.getRowSums()[s]);
+				assert(dynamicRag.getPositionSum(r)[1] == statistics.getColSums()[s]);
+			}
+		}
+	}
+}
+
+void testSegmentationGraph() {
+	testRegionAdjacencyGraph();
+	testDynamicRegionAdjacencyGraph();
+}
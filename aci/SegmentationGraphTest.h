@@ -0,0 +1,13 @@
+/** @file */
+#pragma once
+
+#include <map>
+
+#include "SegmentationGraph.hpp"
+#include "SegmentStatistics.h"
+#include "Utils.hpp"
+
+using namespace cv;
+using namespace std;
+
+void testSegmentationGraph();
@@ -0,0 +1,86 @@
+#include "SegmentationTest.h"
+
+class HueDifferenceCompare {
+private:
+	const vector<double> *hues;
+
+public:
+	HueDifferenceCompare(const vector<double> *hues)
+		: hues(hues)
+	{
+
+	}
+
+	double difference(const pair<int,int> &p) const {
+		return fabs((*this->hues)[p.first] - (*this->hues)[p.second]);
+	}
+
+	bool operator()(const pair<int,int> &p1, const pair<int,int> &p2) const {
+		return this->difference(p1) < this->difference(p2);
+	}
+};
+
+/**
+ * Checks the closest hue pairs against sorting all pairs, on random hues
+ * with many duplicates. Pairs with equal differences may come in any
+ * order, so the differences must be the same, and the partitions the pairs
+ * induce must be the same unless the last pair ties with the next one.
+ */
+static void testClosestHuePairs() {
+	for (int t = 0; t < 500; t++) {
+		int nbSegments = rand() % 40;
+		int nbHues = 1 + rand() % 10;
+		vector<double> hues(nbSegments);
+
+		for (int i = 0; i < nbSegments; i++) {
+			hues[i] = (double)(rand() % nbHues) / nbHues;
+		}
+
+		HueDifferenceCompare compare(&hues);
+		vector<pair<int,int> > allPairs;
+
+		for (int i = 0; i < nbSegments; i++) {
+			for (int j = i + 1; j < nbSegments; j++) {
+				allPairs.push_back(pair<int,int>(i, j));
+			}
+		}
+		stable_sort(allPairs.begin(), allPairs.end(), compare);
+
+		int nbPairs = rand() % (allPairs.size() + 2);
+		vector<pair<int,int> > pairs;
+
+		closestHuePairs(hues, nbPairs, pairs);
+
+		int expectedPairs = min(nbPairs, (int)allPairs.size());
+		assert((int)pairs.size() == expectedPairs);
+
+		set<pair<int,int> > distinctPairs;
+		DisjointSetForest expected(max(nbSegments, 1));
+		DisjointSetForest actual(max(nbSegments, 1));
+
+		for (int i = 0; i < expectedPairs; i++) {
+			assert(pairs[i].first != pairs[i].second);
+			assert(compare.difference(pairs[i]) == compare.difference(allPairs[i]));
+			distinctPairs.insert(pair<int,int>(min(pairs[i].first, pairs[i].second), max(pairs[i].first, pairs[i].second)));
+
+			expected.setUnion(allPairs[i].first, allPairs[i].second);
+			actual.setUnion(pairs[i].first, pairs[i].second);
+		}
+		assert((int)distinctPairs.size() == expectedPairs);
+
+		bool tiedCutoff = expectedPairs > 0 && expectedPairs < (int)allPairs.size()
+			&& compare.difference(allPairs[expectedPairs - 1]) == compare.difference(allPairs[expectedPairs]);
+
+		if (!tiedCutoff) {
+			for (int i = 0; i < nbSegments; i++) {
+				for (int j = i + 1; j < nbSegments; j++) {
+					assert((expected.find(i) == expected.find(j)) == (actual.find(i) == actual.find(j)));
+				}
+			}
+		}
+	}
+}
+
+void testSegmentation() {
+	testClosestHuePairs();
+}
@@ -0,0 +1,10 @@
+/** @file */
+#pragma once
+
+#include <set>
+
+#include "Segmentation.h"
+
+using namespace std;
+
+void testSegmentation();
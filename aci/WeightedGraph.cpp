@@ -1,11 +1,28 @@
 #include "WeightedGraph.hpp"
 
-WeightedGraph::WeightedGraph() {
+// below this number of edges, traversals run sequentially as thread
+// management costs more than it saves.
+#define PARALLEL_GRAPH_THRESHOLD 10000
+// direction switching heuristics for breadthFirstLevels, as suggested by
+// Beamer et al. 2012.
+#define BFS_BOTTOM_UP_ALPHA 14
+#define BFS_TOP_DOWN_BETA 24
+// radix sort parameters: below the threshold edges are sorted by comparison,
+// above it they are split into a fixed number of ranges so the sort result
+// does not depend on the number of threads.
+#define RADIX_SORT_THRESHOLD 1024
+#define RADIX_SORT_CHUNKS 16
+#define RADIX_SORT_BITS 8
+#define RADIX_SORT_BUCKETS (1 << RADIX_SORT_BITS)
+
+WeightedGraph::WeightedGraph() 
+  : arena(NULL)
+{
   
 }
 
-WeightedGraph::WeightedGraph(int numberOfVertices, int maxDegree) 
-  : adjacencyLists(numberOfVertices), degrees(numberOfVertices, 0)
+WeightedGraph::WeightedGraph(int numberOfVertices, int maxDegree, GraphArena *arena) 
+  : adjacencyLists(numberOfVertices, AdjacencyList(ArenaAllocator<HalfEdge>(arena))), degrees(numberOfVertices, 0), arena(arena)
 {
   if (maxDegree > 0) {
     for (int i = 0; i < numberOfVertices; i++) {
@@ -89,10 +106,14 @@ graph_t WeightedGraph::toBoostGraph() {
   return graph;
 }
 
-const vector<HalfEdge> &WeightedGraph::getAdjacencyList(int vertex) const {
+const AdjacencyList &WeightedGraph::getAdjacencyList(int vertex) const {
 	return this->adjacencyLists[vertex];
 }
 
+GraphArena *WeightedGraph::getArena() const {
+	return this->arena;
+}
+
 ostream &operator<<(ostream &os, const WeightedGraph &graph) {
 	for (int i = 0; i < graph.numberOfVertices(); i++) {
 		os<<i<<" : [";
@@ -109,48 +130,62 @@ ostream &operator<<(ostream &os, const WeightedGraph &graph) {
 }
 
 void connectedComponents(const WeightedGraph &graph, vector<int> &inConnectedComponent, int *nbCC) {
-	*nbCC = 0;
-	inConnectedComponent = vector<int>(graph.numberOfVertices(),-1);
-	vector<bool> discovered(graph.numberOfVertices(), false);
-	vector<int> stack;
+	int n = graph.numberOfVertices();
+	int m = (int)graph.getEdges().size();
+	const vector<Edge> &edges = graph.getEdges();
+	ConcurrentDisjointSetForest components(n);
+
+	#pragma omp parallel for if(m > PARALLEL_GRAPH_THRESHOLD)
+	for (int i = 0; i < m; i++) {
+		components.setUnion(edges[i].source, edges[i].destination);
+	}
 
-	stack.reserve(graph.numberOfVertices());
+	// roots are the smallest vertex of their component, and come before any
+	// other vertex of the component in this pass.
+	*nbCC = 0;
+	inConnectedComponent = vector<int>(n,-1);
 
-	for (int i = 0; i < graph.numberOfVertices(); i++) {
-		if (!discovered[i]) {
-			discovered[i] = true;
+	for (int i = 0; i < n; i++) {
+		int root = components.find(i);
 
+		if (root == i) {
 			inConnectedComponent[i] = *nbCC;
+			(*nbCC)++;
+		} else {
+			inConnectedComponent[i] = inConnectedComponent[root];
+		}
+	}
+}
 
-			stack.push_back(i);
+static int sequentialFind(vector<int> &parents, int element) {
+	while (parents[element] != element) {
+		parents[element] = parents[parents[element]];
+		element = parents[element];
+	}
 
-			while (!stack.empty()) {
-				int t = stack.back();
-				stack.pop_back();
+	return element;
+}
 
-				for (int j = 0; j < (int)graph.getAdjacencyList(t).size(); j++) {
-					HalfEdge edge = graph.getAdjacencyList(t)[j];
+bool connected(const WeightedGraph& graph) {
+	int nbComponents = graph.numberOfVertices();
+	vector<int> parents(graph.numberOfVertices());
 
-					if (!discovered[edge.destination]) {
-						discovered[edge.destination] = true;
+	for (int i = 0; i < graph.numberOfVertices(); i++) {
+		parents[i] = i;
+	}
 
-						inConnectedComponent[edge.destination] = *nbCC;
+	for (int i = 0; i < (int)graph.getEdges().size() && nbComponents > 1; i++) {
+		Edge edge = graph.getEdges()[i];
+		int root1 = sequentialFind(parents, edge.source);
+		int root2 = sequentialFind(parents, edge.destination);
 
-						stack.push_back(edge.destination);
-					}
-				}
-			}
-			(*nbCC)++;
+		if (root1 != root2) {
+			parents[max(root1, root2)] = min(root1, root2);
+			nbComponents--;
 		}
 	}
-}
-
-bool connected(const WeightedGraph& graph) {
-	int nbCC;
 
-	connectedComponents(graph, vector<int>(), &nbCC);
-
-	return nbCC == 1;
+	return nbComponents == 1;
 }
 
 bool noLoops(const WeightedGraph& graph) {
@@ -210,7 +245,7 @@ void inducedSubgraphs(const WeightedGraph &graph, const vector<int> &inSubgraph,
 	subgraphs = vector<WeightedGraph>(numberOfSubgraphs);
 
 	for (int i = 0; i < numberOfSubgraphs; i++) {
-		subgraphs[i] = WeightedGraph(subgraphSizes[i]);
+		subgraphs[i] = WeightedGraph(subgraphSizes[i], -1, graph.getArena());
 	}
 	
 	for (int i = 0; i < (int)graph.getEdges().size(); i++) {
@@ -243,33 +278,33 @@ bool compareGraphSize(const WeightedGraph& g1, const WeightedGraph& g2) {
 }
 
 vector<int> breadthFirstSearch(const WeightedGraph &graph, int startingVertex) {
-	vector<bool> marks(graph.numberOfVertices(), false);
+	vector<char> marks(graph.numberOfVertices(), false);
 	vector<int> bfsOrder;
 	bfsOrder.reserve(graph.numberOfVertices());
 
 	// slight variation on the usual BFS for possibly disconnected graphs: iterates 
 	// on all vertices starting from a specific user-defined one. The ending 
 	// condition looks a bit weird, but it just means we stop when we have gone full 
-	// circle.
+	// circle. Vertices are output in the order they are queued, so the output
+	// vector itself serves as the queue.
 	int root = startingVertex;
+	int head = 0;
 	do {
 		if (!marks[root]) {
-			queue<int> toVisit;
 			marks[root] = true;
-			toVisit.push(root);
+			bfsOrder.push_back(root);
 
-			while (!toVisit.empty()) {
-				int current = toVisit.front();
-				toVisit.pop();
-				bfsOrder.push_back(current);
+			while (head < (int)bfsOrder.size()) {
+				int current = bfsOrder[head];
+				head++;
+				const AdjacencyList &adjacencyList = graph.getAdjacencyList(current);
 
-				for (int j = 0; j < (int)graph.getAdjacencyList(current).size(); j++) {
-					HalfEdge edge = graph.getAdjacencyList(current)[j];
-					int neighbor = edge.destination;
+				for (int j = 0; j < (int)adjacencyList.size(); j++) {
+					int neighbor = adjacencyList[j].destination;
 
 					if (!marks[neighbor]) {
 						marks[neighbor] = true;
-						toVisit.push(neighbor);
+						bfsOrder.push_back(neighbor);
 					}
 				}
 			}
@@ -280,6 +315,117 @@ vector<int> breadthFirstSearch(const WeightedGraph &graph, int startingVertex) {
 	return bfsOrder;
 }
 
+/**
+ * Returns true iff each edge of the graph is stored in both directions.
+ */
+static bool isBidirectional(const WeightedGraph &graph) {
+	const vector<Edge> &edges = graph.getEdges();
+
+	for (int i = 0; i < (int)edges.size(); i++) {
+		const AdjacencyList &adjacencyList = graph.getAdjacencyList(edges[i].destination);
+		bool found = false;
+
+		for (int j = 0; j < (int)adjacencyList.size() && !found; j++) {
+			found = adjacencyList[j].destination == edges[i].source;
+		}
+		if (!found) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+vector<int> breadthFirstLevels(const WeightedGraph &graph, int startingVertex, BFSDirection direction) {
+	assert(isBidirectional(graph));
+	int n = graph.numberOfVertices();
+	boost::scoped_array<boost::atomic<int> > levels(new boost::atomic<int>[n]);
+
+	for (int i = 0; i < n; i++) {
+		levels[i].store(-1, boost::memory_order_relaxed);
+	}
+	levels[startingVertex].store(0, boost::memory_order_relaxed);
+
+	vector<int> frontier(1, startingVertex);
+	// number of edges out of vertices not yet visited
+	long long unexploredEdges = graph.getEdges().size();
+	bool bottomUp = false;
+	int level = 0;
+
+	while (!frontier.empty()) {
+		int frontierSize = (int)frontier.size();
+		long long frontierEdges = 0;
+
+		#pragma omp parallel for reduction(+:frontierEdges) if(frontierSize > PARALLEL_GRAPH_THRESHOLD)
+		for (int i = 0; i < frontierSize; i++) {
+			frontierEdges += graph.getAdjacencyList(frontier[i]).size();
+		}
+		unexploredEdges -= frontierEdges;
+
+		if (direction != BFS_DIRECTION_OPTIMIZING) {
+			bottomUp = direction == BFS_BOTTOM_UP;
+		} else if (!bottomUp && frontierEdges > unexploredEdges / BFS_BOTTOM_UP_ALPHA) {
+			bottomUp = true;
+		} else if (bottomUp && frontierSize < n / BFS_TOP_DOWN_BETA) {
+			bottomUp = false;
+		}
+
+		vector<int> nextFrontier;
+
+		#pragma omp parallel if(bottomUp ? n > PARALLEL_GRAPH_THRESHOLD : frontierEdges > PARALLEL_GRAPH_THRESHOLD)
+		{
+			vector<int> localFrontier;
+
+			if (bottomUp) {
+				// each unvisited vertex looks for a parent in the frontier,
+				// stopping at the first one found.
+				#pragma omp for
+				for (int v = 0; v < n; v++) {
+					if (levels[v].load(boost::memory_order_relaxed) < 0) {
+						const AdjacencyList &adjacencyList = graph.getAdjacencyList(v);
+
+						for (int j = 0; j < (int)adjacencyList.size(); j++) {
+							if (levels[adjacencyList[j].destination].load(boost::memory_order_relaxed) == level) {
+								levels[v].store(level + 1, boost::memory_order_relaxed);
+								localFrontier.push_back(v);
+								break;
+							}
+						}
+					}
+				}
+			} else {
+				// each frontier vertex claims its unvisited neighbors.
+				#pragma omp for
+				for (int i = 0; i < frontierSize; i++) {
+					const AdjacencyList &adjacencyList = graph.getAdjacencyList(frontier[i]);
+
+					for (int j = 0; j < (int)adjacencyList.size(); j++) {
+						int unvisited = -1;
+
+						if (levels[adjacencyList[j].destination].compare_exchange_strong(unvisited, level + 1, boost::memory_order_relaxed)) {
+							localFrontier.push_back(adjacencyList[j].destination);
+						}
+					}
+				}
+			}
+
+			#pragma omp critical
+			nextFrontier.insert(nextFrontier.end(), localFrontier.begin(), localFrontier.end());
+		}
+
+		frontier.swap(nextFrontier);
+		level++;
+	}
+
+	vector<int> result(n);
+
+	for (int i = 0; i < n; i++) {
+		result[i] = levels[i].load(boost::memory_order_relaxed);
+	}
+
+	return result;
+}
+
 WeightedGraph permuteVertices(const WeightedGraph &graph, const vector<int> &permutation) {
 	assert(graph.numberOfVertices() == permutation.size());
 	// first compute the inverse permutation
@@ -290,7 +436,7 @@ WeightedGraph permuteVertices(const WeightedGraph &graph, const vector<int> &per
 	}
 
 	// then just add all the edges according to the inverse permutation
-	WeightedGraph permutedGraph(graph.numberOfVertices());
+	WeightedGraph permutedGraph(graph.numberOfVertices(), -1, graph.getArena());
 
 	for (int i = 0; i < (int)graph.getEdges().size(); i++) {
 		Edge edge = graph.getEdges()[i];
@@ -301,4 +447,100 @@ WeightedGraph permuteVertices(const WeightedGraph &graph, const vector<int> &per
 	}
 
 	return permutedGraph;
-}
\ No newline at end of file
+}
+
+static bool compareEdgeWeights(const Edge &edge1, const Edge &edge2) {
+	return edge1.weight < edge2.weight;
+}
+
+/**
+ * Maps a float to an unsigned integer such that comparing keys as unsigned
+ * integers orders them as the floats they come from: positive floats only
+ * get their sign bit set, negative ones are entirely flipped.
+ */
+static unsigned int weightKey(float weight) {
+	unsigned int bits;
+
+	// -0 and 0 compare equal as floats, so they must get the same key.
+	if (weight == 0) {
+		weight = 0;
+	}
+	memcpy(&bits, &weight, sizeof(float));
+
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+void sortEdgesByWeight(vector<Edge> &edges) {
+	int m = (int)edges.size();
+
+	if (m < RADIX_SORT_THRESHOLD) {
+		stable_sort(edges.begin(), edges.end(), compareEdgeWeights);
+		return;
+	}
+
+	vector<unsigned int> keys(m);
+	vector<unsigned int> sortedKeys(m);
+	vector<Edge> sortedEdges(m);
+	vector<int> counts(RADIX_SORT_CHUNKS * RADIX_SORT_BUCKETS);
+
+	#pragma omp parallel for if(m > PARALLEL_GRAPH_THRESHOLD)
+	for (int i = 0; i < m; i++) {
+		keys[i] = weightKey(edges[i].weight);
+	}
+
+	for (int shift = 0; shift < 32; shift += RADIX_SORT_BITS) {
+		fill(counts.begin(), counts.end(), 0);
+
+		// histogram of the current digit in each range of edges.
+		#pragma omp parallel for if(m > PARALLEL_GRAPH_THRESHOLD)
+		for (int c = 0; c < RADIX_SORT_CHUNKS; c++) {
+			int begin = (int)((long long)m * c / RADIX_SORT_CHUNKS);
+			int end = (int)((long long)m * (c + 1) / RADIX_SORT_CHUNKS);
+
+			for (int i = begin; i < end; i++) {
+				counts[c * RADIX_SORT_BUCKETS + ((keys[i] >> shift) & (RADIX_SORT_BUCKETS - 1))]++;
+			}
+		}
+
+		// turns counts into output positions, ordered by digit then range so
+		// the sort is stable. Passes where all keys share the same digit,
+		// typically the exponent bits, are skipped.
+		int offset = 0;
+		bool trivialPass = false;
+
+		for (int d = 0; d < RADIX_SORT_BUCKETS; d++) {
+			int digitStart = offset;
+
+			for (int c = 0; c < RADIX_SORT_CHUNKS; c++) {
+				int count = counts[c * RADIX_SORT_BUCKETS + d];
+
+				counts[c * RADIX_SORT_BUCKETS + d] = offset;
+				offset += count;
+			}
+
+			if (offset - digitStart == m) {
+				trivialPass = true;
+			}
+		}
+
+		if (trivialPass) {
+			continue;
+		}
+
+		#pragma omp parallel for if(m > PARALLEL_GRAPH_THRESHOLD)
+		for (int c = 0; c < RADIX_SORT_CHUNKS; c++) {
+			int begin = (int)((long long)m * c / RADIX_SORT_CHUNKS);
+			int end = (int)((long long)m * (c + 1) / RADIX_SORT_CHUNKS);
+
+			for (int i = begin; i < end; i++) {
+				int position = counts[c * RADIX_SORT_BUCKETS + ((keys[i] >> shift) & (RADIX_SORT_BUCKETS - 1))]++;
+
+				sortedEdges[position] = edges[i];
+				sortedKeys[position] = keys[i];
+			}
+		}
+
+		edges.swap(sortedEdges);
+		keys.swap(sortedKeys);
+	}
+}
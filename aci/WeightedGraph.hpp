@@ -20,6 +20,11 @@
 #include <boost/graph/graph_traits.hpp>
 #include <boost/property_map/property_map.hpp>
 #include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/atomic.hpp>
+#include <boost/scoped_array.hpp>
+
+#include "GraphArena.hpp"
+#include "ConcurrentDisjointSet.hpp"
 
 using namespace std;
 using namespace cv;
@@ -43,11 +48,18 @@ struct HalfEdge {
   float weight;
 };
 
+/**
+ * Adjacency list of a single vertex, optionally drawing its memory from
+ * a GraphArena.
+ */
+typedef vector<HalfEdge, ArenaAllocator<HalfEdge> > AdjacencyList;
+
 class WeightedGraph {
 private:
-  vector<vector<HalfEdge> > adjacencyLists;
+  vector<AdjacencyList> adjacencyLists;
   vector<Edge> edges;
   vector<double> degrees;
+  GraphArena *arena;
 
 public:
   WeightedGraph(); // should not be called
@@ -59,8 +71,12 @@ public:
    * @param numberOfVertices the number of vertices of the graph
    * @param maxDegree an upper bound on the degree of vertices in
    * the graph.
+   * @param arena optional arena the adjacency lists allocate from. The
+   * graph, and any copy of it, must be destroyed before the arena is
+   * released. Graphs derived from this one (induced subgraphs, permutations)
+   * allocate from the same arena.
    */
-  WeightedGraph(int numberOfVertices, int maxDegree = -1);
+  WeightedGraph(int numberOfVertices, int maxDegree = -1, GraphArena *arena = NULL);
   /**
    * Adds an edge to the graph. In the case of an undirected graph,
    * the order of source and destination does not matter.
@@ -104,7 +120,9 @@ public:
   void drawGraphWithEmbedding(vector<Vec<float,2> > verticesPositions, Mat &imageToDrawOn, graph_t boostGraph, embedding_t embedding);
   /**
    * Converts this graph into a boost adjacency list. Drops both
-   * weights and vertices labels.
+   * weights and vertices labels. Only needed for algorithms requiring
+   * an adjacency_list, see WeightedGraphBoostAdapter.hpp to run BGL
+   * algorithms directly on the graph.
    *
    * @return adjacency list representing the same grpah as this.
    */
@@ -115,7 +133,13 @@ public:
    * unidirectional representation, this does not return all adjacent
    * vertices. Use a bidirectional representation for this.
    */
-  const vector<HalfEdge> &getAdjacencyList(int vertex) const;
+  const AdjacencyList &getAdjacencyList(int vertex) const;
+
+  /**
+   * Returns the arena the adjacency lists of this graph allocate from,
+   * NULL if they use the heap.
+   */
+  GraphArena *getArena() const;
 
   friend ostream &operator<<(ostream &os, const WeightedGraph &graph);
 
@@ -138,7 +162,10 @@ public:
 };
 
 /**
- * Computes the connected components of a graph using a simple DFS procedure.
+ * Computes the connected components of a graph using a concurrent union find
+ * over the edge list, parallelized over ranges of edges for large graphs. Edge
+ * direction is ignored. Components are numbered by increasing smallest vertex,
+ * as a sequential DFS over the vertices would.
  *
  * @param graph the graph to compute connected components from.
  * @param inConnectedComponent output vector which associates to each vertex the
@@ -149,7 +176,9 @@ public:
 void connectedComponents(const WeightedGraph &graph, vector<int> &inConnectedComponent, int *nbCC);
 
 /**
- * Checks that a graph is connected.
+ * Checks that a graph is connected, ignoring edge direction. Stops scanning
+ * edges as soon as all vertices are known to be in the same component, without
+ * computing the connected components.
  */
 bool connected(const WeightedGraph& graph);
 
@@ -198,6 +227,30 @@ bool compareGraphSize(const WeightedGraph& g1, const WeightedGraph& g2);
  */
 vector<int> breadthFirstSearch(const WeightedGraph &graph, int startingVertex);
 
+/**
+ * Direction in which breadthFirstLevels expands its frontier.
+ */
+enum BFSDirection { BFS_DIRECTION_OPTIMIZING, BFS_TOP_DOWN, BFS_BOTTOM_UP };
+
+/**
+ * Parallel direction optimizing breadth first search, computing the distance in
+ * number of edges of each vertex from a starting vertex. Switches between
+ * expanding the frontier top-down and having unvisited vertices look for a parent
+ * in the frontier bottom-up, depending on which one explores fewer edges.
+ *
+ * The graph must be bidirectional, e.g. a grid graph built with bidirectional
+ * set to true: bottom-up steps read the adjacency list of unvisited vertices,
+ * so an edge stored in a single direction would only be followed top-down and
+ * the levels would depend on the direction chosen at each step.
+ *
+ * @param graph bidirectional graph to traverse with n vertices.
+ * @param startingVertex vertex in the graph to start the traversal from.
+ * @param direction direction of every step, switching between both by default.
+ * @return n sized vector containing the BFS level of each vertex, -1 for vertices
+ * unreachable from the starting vertex.
+ */
+vector<int> breadthFirstLevels(const WeightedGraph &graph, int startingVertex, BFSDirection direction = BFS_DIRECTION_OPTIMIZING);
+
 /**
  * Permutes the indices of vertices in the graph using some permutation.
  * The permutation indicates which vertex from the input graph corresponds to
@@ -207,3 +260,13 @@ vector<int> breadthFirstSearch(const WeightedGraph &graph, int startingVertex);
  * @param permutation permutation of the vertices.
  */
 WeightedGraph permuteVertices(const WeightedGraph &graph, const vector<int> &permutation);
+
+/**
+ * Sorts edges by increasing weight with a stable LSD radix sort on the bit
+ * representation of weights, parallelized over ranges of edges for large
+ * edge lists. Edges of equal weight keep their relative order, so the result
+ * is the same as std::stable_sort's.
+ *
+ * @param edges edges to sort in place.
+ */
+void sortEdgesByWeight(vector<Edge> &edges);
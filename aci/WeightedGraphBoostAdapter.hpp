@@ -0,0 +1,177 @@
+/** @file */
+/**
+ * Boost Graph Library adapter for WeightedGraph. Specializes graph_traits
+ * and property_map so BGL algorithms (dijkstra_shortest_paths,
+ * kruskal_minimum_spanning_tree, breadth_first_search...) run directly on a
+ * WeightedGraph and its edge weights, without the copy made by
+ * WeightedGraph::toBoostGraph.
+ *
+ * Vertices are the integers 0 to numberOfVertices() - 1, and edge descriptors
+ * are Edge values. Out edges of a vertex are its adjacency list, so the graph
+ * is seen as directed: build it with a bidirectional representation (see
+ * gridGraph for instance) to run algorithms which expect every edge to be
+ * traversable both ways.
+ */
+#pragma once
+
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/properties.hpp>
+#include <boost/property_map/property_map.hpp>
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+
+#include "WeightedGraph.hpp"
+
+/**
+ * Builds the full edge corresponding to a half edge in the adjacency list
+ * of a given vertex.
+ */
+struct HalfEdgeToEdge {
+  typedef Edge result_type;
+
+  int source;
+
+  HalfEdgeToEdge(int source = -1)
+    : source(source)
+  {
+
+  }
+
+  Edge operator()(const HalfEdge &halfEdge) const {
+    Edge edge;
+
+    edge.source = this->source;
+    edge.destination = halfEdge.destination;
+    edge.weight = halfEdge.weight;
+
+    return edge;
+  }
+};
+
+/**
+ * Traversal category of WeightedGraph as a BGL graph.
+ */
+struct weighted_graph_traversal_tag
+  : public boost::vertex_list_graph_tag,
+    public boost::edge_list_graph_tag,
+    public boost::incidence_graph_tag
+{
+
+};
+
+/**
+ * Readable property map associating its weight to each edge.
+ */
+struct WeightedGraphWeightMap {
+  typedef Edge key_type;
+  typedef float value_type;
+  typedef float reference;
+  typedef boost::readable_property_map_tag category;
+};
+
+namespace boost {
+  template <>
+  struct graph_traits<WeightedGraph> {
+    typedef int vertex_descriptor;
+    typedef Edge edge_descriptor;
+    typedef directed_tag directed_category;
+    typedef allow_parallel_edge_tag edge_parallel_category;
+    typedef weighted_graph_traversal_tag traversal_category;
+
+    typedef counting_iterator<int> vertex_iterator;
+    typedef vector<Edge>::const_iterator edge_iterator;
+    typedef transform_iterator<HalfEdgeToEdge, AdjacencyList::const_iterator, Edge, Edge> out_edge_iterator;
+    typedef void in_edge_iterator;
+    typedef void adjacency_iterator;
+
+    typedef int vertices_size_type;
+    typedef int edges_size_type;
+    typedef int degree_size_type;
+
+    static vertex_descriptor null_vertex() {
+      return -1;
+    }
+  };
+
+  template <>
+  struct property_map<WeightedGraph, edge_weight_t> {
+    typedef WeightedGraphWeightMap type;
+    typedef WeightedGraphWeightMap const_type;
+  };
+
+  template <>
+  struct property_map<WeightedGraph, vertex_index_t> {
+    typedef typed_identity_property_map<int> type;
+    typedef typed_identity_property_map<int> const_type;
+  };
+}
+
+// BGL concepts require edge descriptors to be equality comparable.
+inline bool operator==(const Edge &e1, const Edge &e2) {
+  return e1.source == e2.source && e1.destination == e2.destination && e1.weight == e2.weight;
+}
+
+inline bool operator!=(const Edge &e1, const Edge &e2) {
+  return !(e1 == e2);
+}
+
+// VertexListGraph
+inline pair<counting_iterator<int>, counting_iterator<int> > vertices(const WeightedGraph &graph) {
+  return make_pair(counting_iterator<int>(0), counting_iterator<int>(graph.numberOfVertices()));
+}
+
+inline int num_vertices(const WeightedGraph &graph) {
+  return graph.numberOfVertices();
+}
+
+// EdgeListGraph
+inline pair<vector<Edge>::const_iterator, vector<Edge>::const_iterator> edges(const WeightedGraph &graph) {
+  return make_pair(graph.getEdges().begin(), graph.getEdges().end());
+}
+
+inline int num_edges(const WeightedGraph &graph) {
+  return (int)graph.getEdges().size();
+}
+
+inline int source(const Edge &edge, const WeightedGraph &) {
+  return edge.source;
+}
+
+inline int target(const Edge &edge, const WeightedGraph &) {
+  return edge.destination;
+}
+
+// IncidenceGraph
+inline pair<graph_traits<WeightedGraph>::out_edge_iterator, graph_traits<WeightedGraph>::out_edge_iterator> out_edges(int vertex, const WeightedGraph &graph) {
+  typedef graph_traits<WeightedGraph>::out_edge_iterator out_edge_iterator;
+  const AdjacencyList &adjacencyList = graph.getAdjacencyList(vertex);
+
+  return make_pair(
+    out_edge_iterator(adjacencyList.begin(), HalfEdgeToEdge(vertex)),
+    out_edge_iterator(adjacencyList.end(), HalfEdgeToEdge(vertex)));
+}
+
+inline int out_degree(int vertex, const WeightedGraph &graph) {
+  return (int)graph.getAdjacencyList(vertex).size();
+}
+
+// property maps
+inline float get(const WeightedGraphWeightMap &, const Edge &edge) {
+  return edge.weight;
+}
+
+inline WeightedGraphWeightMap get(edge_weight_t, const WeightedGraph &) {
+  return WeightedGraphWeightMap();
+}
+
+inline float get(edge_weight_t, const WeightedGraph &, const Edge &edge) {
+  return edge.weight;
+}
+
+inline typed_identity_property_map<int> get(vertex_index_t, const WeightedGraph &) {
+  return typed_identity_property_map<int>();
+}
+
+inline int get(vertex_index_t, const WeightedGraph &, int vertex) {
+  return vertex;
+}
@@ -0,0 +1,168 @@
+#include "WeightedGraphTest.h"
+
+BOOST_CONCEPT_ASSERT((VertexListGraphConcept<WeightedGraph>));
+BOOST_CONCEPT_ASSERT((IncidenceGraphConcept<WeightedGraph>));
+BOOST_CONCEPT_ASSERT((EdgeListGraphConcept<WeightedGraph>));
+BOOST_CONCEPT_ASSERT((ReadablePropertyMapConcept<WeightedGraphWeightMap, Edge>));
+
+/**
+ * Adds an edge in both directions, so BGL algorithms can traverse it either
+ * way.
+ */
+static void addUndirectedEdge(WeightedGraph &graph, int source, int destination, float weight) {
+	graph.addEdge(source, destination, weight);
+	graph.addEdge(destination, source, weight);
+}
+
+/**
+ * Small graph with known shortest path distances from vertex 0:
+ *
+ *   0 -1- 1 -2- 2
+ *   |     |     |
+ *   4     1     1
+ *   |     |     |
+ *   3 -1- 4 -5- 5
+ *
+ * with vertex 6 isolated.
+ */
+static WeightedGraph testGraph() {
+	WeightedGraph graph(7, 3);
+
+	addUndirectedEdge(graph, 0, 1, 1);
+	addUndirectedEdge(graph, 1, 2, 2);
+	addUndirectedEdge(graph, 0, 3, 4);
+	addUndirectedEdge(graph, 1, 4, 1);
+	addUndirectedEdge(graph, 2, 5, 1);
+	addUndirectedEdge(graph, 3, 4, 1);
+	addUndirectedEdge(graph, 4, 5, 5);
+
+	return graph;
+}
+
+/**
+ * Runs Dijkstra's algorithm directly on a WeightedGraph through the adapter.
+ */
+static void testAdapterDijkstra() {
+	WeightedGraph graph = testGraph();
+	vector<float> distances(graph.numberOfVertices());
+	vector<int> predecessors(graph.numberOfVertices());
+	float expected[] = {0, 1, 3, 3, 2, 4};
+
+	dijkstra_shortest_paths(graph, 0,
+		predecessor_map(make_iterator_property_map(predecessors.begin(), get(vertex_index, graph)))
+		.distance_map(make_iterator_property_map(distances.begin(), get(vertex_index, graph))));
+
+	for (int i = 0; i < 6; i++) {
+		assert(distances[i] == expected[i]);
+	}
+	assert(distances[6] == numeric_limits<float>::max());
+	assert(predecessors[0] == 0 && predecessors[3] == 4 && predecessors[5] == 2 && predecessors[6] == 6);
+}
+
+/**
+ * Runs Kruskal's algorithm directly on a WeightedGraph through the adapter.
+ */
+static void testAdapterKruskal() {
+	WeightedGraph graph = testGraph();
+	vector<Edge> spanningTree;
+
+	kruskal_minimum_spanning_tree(graph, back_inserter(spanningTree));
+
+	float totalWeight = 0;
+
+	for (int i = 0; i < (int)spanningTree.size(); i++) {
+		totalWeight += spanningTree[i].weight;
+	}
+	assert(spanningTree.size() == 5);
+	assert(totalWeight == 6);
+}
+
+/**
+ * Bidirectional 4-connected grid graph where some vertices are left without
+ * edges, so it may have several connected components.
+ */
+static WeightedGraph randomGridGraph(int rows, int cols) {
+	WeightedGraph graph(rows * cols, 4);
+	vector<bool> holes(rows * cols);
+
+	for (int i = 0; i < rows * cols; i++) {
+		holes[i] = rand() % 5 == 0;
+	}
+
+	for (int i = 0; i < rows; i++) {
+		for (int j = 0; j < cols; j++) {
+			int vertex = i * cols + j;
+
+			if (holes[vertex]) {
+				continue;
+			}
+			if (i + 1 < rows && !holes[vertex + cols]) {
+				addUndirectedEdge(graph, vertex, vertex + cols, 1);
+			}
+			if (j + 1 < cols && !holes[vertex + 1]) {
+				addUndirectedEdge(graph, vertex, vertex + 1, 1);
+			}
+		}
+	}
+
+	return graph;
+}
+
+/**
+ * Derives the levels of a breadth first search from its traversal order: the
+ * parent of a vertex is its neighbor explored first, which has the lowest
+ * level. The traversal restarts from another root once the component of the
+ * starting vertex is exhausted, so vertices from there on are unreachable.
+ */
+static vector<int> levelsFromTraversal(const WeightedGraph &graph, const vector<int> &order) {
+	vector<int> levels(graph.numberOfVertices(), -1);
+
+	levels[order[0]] = 0;
+
+	for (int k = 1; k < (int)order.size(); k++) {
+		const AdjacencyList &adjacencyList = graph.getAdjacencyList(order[k]);
+		int level = -1;
+
+		for (int j = 0; j < (int)adjacencyList.size(); j++) {
+			int neighborLevel = levels[adjacencyList[j].destination];
+
+			if (neighborLevel >= 0 && (level < 0 || neighborLevel + 1 < level)) {
+				level = neighborLevel + 1;
+			}
+		}
+		if (level < 0) {
+			break;
+		}
+		levels[order[k]] = level;
+	}
+
+	return levels;
+}
+
+/**
+ * Checks the levels of the direction optimizing breadth first search against
+ * the sequential one, forcing top-down and bottom-up steps as well as
+ * letting the heuristic switch between both. The largest grids go through the
+ * parallel code path.
+ */
+static void testBreadthFirstLevels() {
+	BFSDirection directions[] = {BFS_DIRECTION_OPTIMIZING, BFS_TOP_DOWN, BFS_BOTTOM_UP};
+
+	for (int t = 0; t < 50; t++) {
+		int rows = t % 10 == 0 ? 120 + rand() % 30 : 1 + rand() % 30;
+		int cols = t % 10 == 0 ? 120 + rand() % 30 : 1 + rand() % 30;
+		WeightedGraph graph = randomGridGraph(rows, cols);
+		int startingVertex = rand() % graph.numberOfVertices();
+		vector<int> expected = levelsFromTraversal(graph, breadthFirstSearch(graph, startingVertex));
+
+		for (int d = 0; d < 3; d++) {
+			assert(breadthFirstLevels(graph, startingVertex, directions[d]) == expected);
+		}
+	}
+}
+
+void testWeightedGraph() {
+	testAdapterDijkstra();
+	testAdapterKruskal();
+	testBreadthFirstLevels();
+}
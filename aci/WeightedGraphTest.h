@@ -0,0 +1,16 @@
+/** @file */
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <boost/concept/assert.hpp>
+#include <boost/graph/graph_concepts.hpp>
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+#include <boost/graph/kruskal_min_spanning_tree.hpp>
+
+#include "WeightedGraph.hpp"
+#include "WeightedGraphBoostAdapter.hpp"
+
+using namespace std;
+
+void testWeightedGraph();
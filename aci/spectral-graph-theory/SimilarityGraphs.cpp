@@ -25,7 +25,7 @@ NeighborhoodGraph::NeighborhoodGraph(double radius)
 }
 
 void NeighborhoodGraph::operator() (SimilarityMatrix &similarity, WeightedGraph &graph) const {
-	graph = WeightedGraph(similarity.rows());
+	graph = WeightedGraph(similarity.rows(), -1, graph.getArena());
 
 	for (int i = 0; i < similarity.rows(); i++) {
 		for (int j = i + 1; j < similarity.rows(); j++) {
@@ -62,7 +62,7 @@ public:
 void KNearestGraph::operator() (SimilarityMatrix &similarity, WeightedGraph &graph) const {
 	assert(similarity.rows() > k);
 	set<pair<int,int> > adjMat;
-	graph = WeightedGraph(similarity.rows());
+	graph = WeightedGraph(similarity.rows(), -1, graph.getArena());
 
 	for (int i = 0; i < similarity.rows(); i++) {
 		// compute the k nearest neighbor of this sample
@@ -104,7 +104,7 @@ MutualKNearestGraph::MutualKNearestGraph(int k)
 void MutualKNearestGraph::operator() (SimilarityMatrix &similarity, WeightedGraph &graph) const {
 	assert(similarity.rows() > k);
 	MatrixXd adjMat = MatrixXd::Zero(similarity.rows(), similarity.rows());
-	graph = WeightedGraph(similarity.rows());
+	graph = WeightedGraph(similarity.rows(), -1, graph.getArena());
 
 	for (int i = 0; i < similarity.rows(); i++) {
 		// compute the k nearest neighbor of this sample
@@ -141,7 +141,7 @@ CompleteGraph::CompleteGraph() {
 }
 
 void CompleteGraph::operator() (SimilarityMatrix &similarity, WeightedGraph &graph) const {
-	graph = WeightedGraph(similarity.rows(), similarity.rows() - 1);
+	graph = WeightedGraph(similarity.rows(), similarity.rows() - 1, graph.getArena());
 
 	for (int i = 0; i < similarity.rows(); i++) {
 		for (int j = i + 1; j < similarity.rows(); j++) {
@@ -72,7 +72,8 @@ public:
 	 * Compute a similarity graph out of a similarity matrix or function.
 	 *
 	 * @param simFunc input similarity matrix or function.
-	 * @param graph output similarity graph.
+	 * @param graph output similarity graph. If it was constructed with an
+	 * arena, the similarity graph allocates from the same arena.
 	 */
 	virtual void operator() (SimilarityMatrix &similarity, WeightedGraph &graph) const = 0;
 };